@@ -0,0 +1,135 @@
+#include "apikeypool.h"
+#include <algorithm>
+
+ApiKeyPool::ApiKeyPool()
+{
+    m_clock.start();
+}
+
+void ApiKeyPool::setKeys(const QStringList& keys)
+{
+    QList<Key> updated;
+    for (const QString& key : keys) {
+        if (key.isEmpty()) continue;
+        auto existing = std::find_if(m_keys.begin(), m_keys.end(), [&key](const Key& k) {
+            return k.key == key;
+        });
+        if (existing != m_keys.end()) {
+            Key k = *existing;
+            k.revoked = false;
+            updated.append(k);
+        } else {
+            Key k;
+            k.key = key;
+            k.tokens = m_rateLimit;
+            updated.append(k);
+        }
+    }
+    m_keys = updated;
+}
+
+void ApiKeyPool::setRateLimit(int uploadsPerMinute)
+{
+    m_rateLimit = qMax(uploadsPerMinute, 0);
+    for (Key& k : m_keys) {
+        k.tokens = qMin<double>(k.tokens, m_rateLimit);
+    }
+}
+
+void ApiKeyPool::refill()
+{
+    const qint64 now = m_clock.elapsed();
+    const double earned = (now - m_lastRefill) * m_rateLimit / 60000.0;
+    m_lastRefill = now;
+
+    // A full bucket allows one minute's worth of uploads as a burst
+    for (Key& k : m_keys) {
+        k.tokens = qMin<double>(k.tokens + earned, m_rateLimit);
+    }
+}
+
+QString ApiKeyPool::acquire()
+{
+    refill();
+    const qint64 now = m_clock.elapsed();
+
+    Key* best = nullptr;
+    for (Key& k : m_keys) {
+        if (k.revoked || k.coolDownUntil > now) continue;
+        if (m_rateLimit > 0 && k.tokens < 1) continue;
+
+        // Least loaded first; among equals, the one with the most headroom
+        if (!best || k.inFlight < best->inFlight ||
+            (k.inFlight == best->inFlight && k.tokens > best->tokens)) {
+            best = &k;
+        }
+    }
+    if (!best) return QString();
+
+    if (m_rateLimit > 0) {
+        best->tokens -= 1;
+    }
+    ++best->inFlight;
+    return best->key;
+}
+
+bool ApiKeyPool::release(const QString& key, int statusCode, int retryAfterSeconds)
+{
+    auto it = std::find_if(m_keys.begin(), m_keys.end(), [&key](const Key& k) {
+        return k.key == key;
+    });
+    if (it == m_keys.end()) return true;
+
+    it->inFlight = qMax(it->inFlight - 1, 0);
+
+    if (statusCode == 401 || statusCode == 403) {
+        it->revoked = true;
+        return false;
+    }
+    if (statusCode == 429) {
+        const int seconds = retryAfterSeconds > 0 ? retryAfterSeconds : DefaultRetryAfterSeconds;
+        it->coolDownUntil = m_clock.elapsed() + qint64(seconds) * 1000;
+        it->tokens = 0;
+    }
+    return true;
+}
+
+QString ApiKeyPool::primaryKey() const
+{
+    for (const Key& k : m_keys) {
+        if (!k.revoked) return k.key;
+    }
+    return QString();
+}
+
+bool ApiKeyPool::hasUsableKeys() const
+{
+    return usableKeyCount() > 0;
+}
+
+int ApiKeyPool::usableKeyCount() const
+{
+    return int(std::count_if(m_keys.begin(), m_keys.end(), [](const Key& k) {
+        return !k.revoked;
+    }));
+}
+
+qint64 ApiKeyPool::msUntilAvailable()
+{
+    refill();
+    const qint64 now = m_clock.elapsed();
+
+    qint64 soonest = -1;
+    for (const Key& k : m_keys) {
+        if (k.revoked) continue;
+
+        qint64 wait = qMax<qint64>(k.coolDownUntil - now, 0);
+        if (m_rateLimit > 0 && k.tokens < 1) {
+            wait = qMax(wait, qint64((1 - k.tokens) * 60000.0 / m_rateLimit) + 1);
+        }
+        if (soonest < 0 || wait < soonest) {
+            soonest = wait;
+        }
+    }
+    return soonest;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+// Set of API keys that uploads are spread across, so bulk jobs are not
+// capped by a single account's rate limit. Each key has its own token
+// bucket (uploads per minute) and in-flight count; acquire() picks the
+// least-loaded key that still has a token. A key the server rejects with
+// 401/403 is dropped from rotation until the keys are set again, and one
+// answering 429 sits out its Retry-After period.
+//
+// Not thread-safe; owned and used by UploadEngine on the network thread.
+class ApiKeyPool {
+public:
+    ApiKeyPool();
+
+    // Keeps load and bucket state for keys that stay in the set; revoked
+    // keys are given another chance since the user just re-entered them
+    void setKeys(const QStringList& keys);
+
+    // 0 disables the per-key limit
+    void setRateLimit(int uploadsPerMinute);
+
+    // Returns an empty string when no key can take an upload right now
+    QString acquire();
+    // Reports the outcome of an upload sent with key; returns false if the
+    // key was dropped from rotation because of it
+    bool release(const QString& key, int statusCode, int retryAfterSeconds = 0);
+
+    // Key for requests that are not load balanced (e.g. deletes)
+    QString primaryKey() const;
+
+    bool hasUsableKeys() const;
+    int usableKeyCount() const;
+    // Milliseconds until acquire() can next succeed, or -1 if never
+    qint64 msUntilAvailable();
+
+private:
+    struct Key {
+        QString key;
+        int inFlight = 0;
+        double tokens = 0;
+        bool revoked = false;
+        qint64 coolDownUntil = 0;
+    };
+
+    void refill();
+
+    static constexpr int DefaultRetryAfterSeconds = 60;
+
+    QList<Key> m_keys;
+    int m_rateLimit = 0;
+    QElapsedTimer m_clock;
+    qint64 m_lastRefill = 0;
+};
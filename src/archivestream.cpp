@@ -0,0 +1,417 @@
+#include "archivestream.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <cstring>
+#include <memory>
+
+#ifdef EZ_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+constexpr qint64 TarBlockSize = 512;
+
+qint64 paddedSize(qint64 size)
+{
+    return (size + TarBlockSize - 1) / TarBlockSize * TarBlockSize;
+}
+
+// Numeric tar fields are NUL-terminated octal; values that do not fit fall
+// back to the GNU base-256 encoding (needed for members of 8 GiB and up)
+void writeNumber(char* field, int width, qint64 value)
+{
+    qint64 limit = 1;
+    for (int i = 0; i < width - 1; ++i) {
+        limit *= 8;
+    }
+
+    if (value < limit) {
+        for (int i = width - 2; i >= 0; --i) {
+            field[i] = char('0' + (value & 7));
+            value >>= 3;
+        }
+        field[width - 1] = '\0';
+        return;
+    }
+
+    for (int i = width - 1; i > 0; --i) {
+        field[i] = char(value & 0xff);
+        value >>= 8;
+    }
+    field[0] = char(0x80);
+}
+
+QByteArray tarHeader(const QByteArray& name, qint64 size, qint64 mtime, char type)
+{
+    QByteArray header(TarBlockSize, '\0');
+    char* h = header.data();
+
+    std::memcpy(h, name.constData(), qMin<qsizetype>(name.size(), 100));
+    writeNumber(h + 100, 8, 0644);  // mode
+    writeNumber(h + 108, 8, 0);     // uid
+    writeNumber(h + 116, 8, 0);     // gid
+    writeNumber(h + 124, 12, size);
+    writeNumber(h + 136, 12, mtime);
+    std::memset(h + 148, ' ', 8);   // checksum is computed with this blank
+    h[156] = type;
+    std::memcpy(h + 257, "ustar", 6);
+    std::memcpy(h + 263, "00", 2);
+
+    unsigned int checksum = 0;
+    for (char c : header) {
+        checksum += static_cast<unsigned char>(c);
+    }
+    writeNumber(h + 148, 7, checksum);
+
+    return header;
+}
+
+// Names longer than the 100-byte header field are carried in a preceding
+// GNU long-name entry
+bool needsLongName(const QByteArray& name)
+{
+    return name.size() >= 100;
+}
+
+} // namespace
+
+ArchiveStream::ArchiveStream(const QStringList& sourcePaths, std::shared_ptr<BufferPool> pool,
+                             qint64 maxSize, QObject *parent)
+    : QIODevice(parent)
+    , m_sourcePaths(sourcePaths)
+    , m_pool(std::move(pool))
+    , m_maxSize(maxSize)
+{
+}
+
+ArchiveStream::~ArchiveStream()
+{
+    if (m_producer) {
+        m_cancelled = true;
+        {
+            QMutexLocker locker(&m_mutex);
+            m_spaceAvailable.wakeAll();
+        }
+        m_producer->wait();
+        delete m_producer;
+    }
+}
+
+void ArchiveStream::start()
+{
+    if (m_producer) return;
+
+    m_producer = QThread::create([this]() { run(); });
+    m_producer->setObjectName("ArchiveStream");
+    m_producer->start();
+}
+
+bool ArchiveStream::isCompressed()
+{
+#ifdef EZ_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+QString ArchiveStream::fileExtension()
+{
+    return isCompressed() ? "tar.zst" : "tar";
+}
+
+QString ArchiveStream::mimeType()
+{
+    return isCompressed() ? "application/zstd" : "application/x-tar";
+}
+
+void ArchiveStream::run()
+{
+    if (!collectMembers()) {
+        emit failed("No readable files to archive");
+        return;
+    }
+
+    // Read buffer, compressor output and the first outgoing block are taken
+    // together; any later wait happens only after a block was queued for
+    // the consumer, so producers waiting in acquire() cannot deadlock each
+    // other. Blocks held by tryAcquire() users are bounded by those users.
+    std::vector<BufferPool::Block> working = m_pool->acquire(isCompressed() ? 3 : 2, &m_cancelled);
+    if (working.empty()) return;
+    BufferPool::Block& readBuffer = working[0];
+    BufferPool::Block& compressBuffer = isCompressed() ? working[1] : working[0];
+    m_output = std::move(working.back());
+
+    // Dry pass: only count what the real pass is going to produce, and give
+    // up as soon as it is too large rather than compress the whole selection
+    qint64 counted = 0;
+    bool ok = writeArchive([this, &counted](const char*, qint64 size) {
+        counted += size;
+        return !m_cancelled && counted <= m_maxSize;
+    }, readBuffer, compressBuffer);
+    if (m_cancelled) return;
+    if (counted > m_maxSize) {
+        emit failed(QString("Archive is larger than %1MB after compression").arg(m_maxSize / (1024 * 1024)));
+        return;
+    }
+    if (!ok) {
+        emit failed("Failed to build archive");
+        return;
+    }
+
+    m_archiveSize = counted;
+    emit sizeKnown(counted);
+
+    ok = writeArchive([this](const char* data, qint64 size) {
+        return pushOutput(data, size);
+    }, readBuffer, compressBuffer);
+    if (m_overrun) {
+        finishProducing("Archive contents changed while uploading");
+        return;
+    }
+    ok = ok && flushOutput(false);
+
+    if (!ok) {
+        finishProducing("Failed to build archive");
+    } else if (m_produced != m_archiveSize) {
+        finishProducing("Archive contents changed while uploading");
+    } else {
+        finishProducing();
+    }
+}
+
+bool ArchiveStream::collectMembers()
+{
+    auto addMember = [this](const QFileInfo& info, const QString& name) {
+        Member member;
+        member.filePath = info.absoluteFilePath();
+        member.name = name.toUtf8();
+        member.size = info.size();
+        member.mtime = info.lastModified().toSecsSinceEpoch();
+        m_members.append(member);
+        m_memberNames.append(name);
+    };
+
+    for (const QString& sourcePath : std::as_const(m_sourcePaths)) {
+        QFileInfo sourceInfo(sourcePath);
+        if (sourceInfo.isFile()) {
+            addMember(sourceInfo, sourceInfo.fileName());
+        } else if (sourceInfo.isDir()) {
+            // Keep the dropped directory's own name as the top-level folder
+            QDir baseDir = sourceInfo.dir();
+            QDirIterator it(sourceInfo.absoluteFilePath(),
+                            QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot,
+                            QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                if (m_cancelled) return false;
+                QFileInfo info(it.next());
+                addMember(info, baseDir.relativeFilePath(info.absoluteFilePath()));
+            }
+        }
+    }
+
+    m_tarSize = 2 * TarBlockSize;  // end-of-archive marker
+    for (const Member& member : std::as_const(m_members)) {
+        if (needsLongName(member.name)) {
+            m_tarSize += TarBlockSize + paddedSize(member.name.size() + 1);
+        }
+        m_tarSize += TarBlockSize + paddedSize(member.size);
+    }
+
+    return !m_members.isEmpty();
+}
+
+bool ArchiveStream::writeArchive(const Sink& sink, BufferPool::Block& readBuffer,
+                                 BufferPool::Block& compressBuffer)
+{
+#ifdef EZ_HAVE_ZSTD
+    std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(), &ZSTD_freeCCtx);
+    if (!cctx) return false;
+
+    // Both passes must use identical parameters to produce identical output
+    ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, 3);
+    ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_checksumFlag, 1);
+
+    auto compress = [&](const char* data, qint64 size, ZSTD_EndDirective mode) {
+        ZSTD_inBuffer in{data, size_t(size), 0};
+        bool done = false;
+        while (!done) {
+            ZSTD_outBuffer out{compressBuffer.data(), size_t(compressBuffer.capacity()), 0};
+            size_t remaining = ZSTD_compressStream2(cctx.get(), &out, &in, mode);
+            if (ZSTD_isError(remaining)) return false;
+            if (out.pos > 0 && !sink(compressBuffer.constData(), qint64(out.pos))) return false;
+            done = (mode == ZSTD_e_end) ? remaining == 0 : in.pos == in.size;
+        }
+        return true;
+    };
+
+    auto compressSink = [&](const char* data, qint64 size) { return compress(data, size, ZSTD_e_continue); };
+    if (!writeTar(compressSink, readBuffer)) {
+        return false;
+    }
+    return compress(nullptr, 0, ZSTD_e_end);
+#else
+    Q_UNUSED(compressBuffer);
+    return writeTar(sink, readBuffer);
+#endif
+}
+
+bool ArchiveStream::writeTar(const Sink& sink, BufferPool::Block& readBuffer)
+{
+    char* buffer = readBuffer.data();
+    const QByteArray zeros(TarBlockSize, '\0');
+
+    for (const Member& member : std::as_const(m_members)) {
+        if (needsLongName(member.name)) {
+            QByteArray longName = member.name + '\0';
+            if (!sink(tarHeader("././@LongLink", longName.size(), 0, 'L').constData(), TarBlockSize)) return false;
+            longName.append(paddedSize(longName.size()) - longName.size(), '\0');
+            if (!sink(longName.constData(), longName.size())) return false;
+        }
+
+        if (!sink(tarHeader(member.name, member.size, member.mtime, '0').constData(), TarBlockSize)) return false;
+
+        // Always emit exactly the size recorded in the header: a file that
+        // shrank is zero-filled and a file that grew is cut off, so the
+        // archive stays well-formed either way
+        QFile file(member.filePath);
+        bool readable = file.open(QIODevice::ReadOnly);
+        qint64 remaining = member.size;
+        while (remaining > 0) {
+            qint64 wanted = qMin(remaining, readBuffer.capacity());
+            qint64 got = readable ? file.read(buffer, wanted) : -1;
+            if (got <= 0) {
+                std::memset(buffer, 0, size_t(wanted));
+                got = wanted;
+                readable = false;
+            }
+            if (!sink(buffer, got)) return false;
+            remaining -= got;
+        }
+
+        qint64 padding = paddedSize(member.size) - member.size;
+        if (padding > 0 && !sink(zeros.constData(), padding)) return false;
+    }
+
+    return sink(zeros.constData(), TarBlockSize) && sink(zeros.constData(), TarBlockSize);
+}
+
+bool ArchiveStream::pushOutput(const char* data, qint64 size)
+{
+    // More output than the advertised size: fail now, while the consumer
+    // is still short of size() and the upload cannot complete truncated
+    if (m_produced + size > m_archiveSize) {
+        m_overrun = true;
+        return false;
+    }
+
+    while (size > 0) {
+        qint64 n = qMin(size, m_output.capacity() - m_output.size);
+        std::memcpy(m_output.data() + m_output.size, data, size_t(n));
+        m_output.size += n;
+        m_produced += n;
+        data += n;
+        size -= n;
+
+        // The block holding the last advertised byte is only handed over by
+        // run() once the pass is known to have ended there
+        if (m_output.size == m_output.capacity() && m_produced < m_archiveSize && !flushOutput(true)) {
+            return false;
+        }
+    }
+    return !m_cancelled;
+}
+
+bool ArchiveStream::flushOutput(bool needMore)
+{
+    if (m_output.size > 0) {
+        QMutexLocker locker(&m_mutex);
+        while (m_chunks.size() >= MaxQueuedBlocks && !m_cancelled) {
+            m_spaceAvailable.wait(&m_mutex);
+        }
+        if (m_cancelled) return false;
+
+        m_chunks.push_back(std::move(m_output));
+        notifyReader();
+    }
+
+    // While output is queued, leave a block free for the consumer side (a
+    // FanOutBuffer reading this stream needs one to drain the queue at all)
+    if (needMore && m_output.isNull()) {
+        QMutexLocker locker(&m_mutex);
+        while (!m_chunks.empty() && !m_cancelled &&
+               m_pool->bytesInUse() + 2 * BufferPool::BlockSize > m_pool->budget()) {
+            m_spaceAvailable.wait(&m_mutex, 50);
+        }
+    }
+
+    // Waits on the global budget outside m_mutex so the consumer can drain
+    if (needMore && m_output.isNull()) {
+        m_output = m_pool->acquire(&m_cancelled);
+    }
+    return !needMore || !m_output.isNull();
+}
+
+void ArchiveStream::finishProducing(const QString& error)
+{
+    QMutexLocker locker(&m_mutex);
+    m_finished = true;
+    m_error = error;
+    notifyReader();
+}
+
+void ArchiveStream::notifyReader()
+{
+    // Only after the consumer came up empty, and queued onto its thread;
+    // a posted event for this device is dropped if it is destroyed first
+    if (!m_readerWaiting) return;
+    m_readerWaiting = false;
+    QMetaObject::invokeMethod(this, [this]() {
+        emit readyRead();
+    }, Qt::QueuedConnection);
+}
+
+qint64 ArchiveStream::readData(char* data, qint64 maxSize)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // Never wait for the producer on the consumer's (event loop) thread
+    if (m_chunks.empty() && !m_finished) {
+        m_readerWaiting = true;
+        return 0;
+    }
+
+    if (!m_error.isEmpty()) {
+        setErrorString(m_error);
+        return -1;
+    }
+
+    qint64 copied = 0;
+    while (copied < maxSize && !m_chunks.empty()) {
+        BufferPool::Block& chunk = m_chunks.front();
+        qint64 n = qMin(maxSize - copied, chunk.size - chunk.offset);
+        std::memcpy(data + copied, chunk.constData() + chunk.offset, size_t(n));
+        copied += n;
+        chunk.offset += n;
+        if (chunk.offset == chunk.size) {
+            // Returns the block to the pool
+            m_chunks.pop_front();
+        }
+    }
+
+    m_spaceAvailable.wakeAll();
+
+    if (copied == 0 && m_finished) {
+        return -1;
+    }
+    return copied;
+}
+
+qint64 ArchiveStream::writeData(const char*, qint64)
+{
+    return -1;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "bufferpool.h"
+#include <QIODevice>
+#include <QByteArray>
+#include <QMutex>
+#include <QStringList>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+
+class QThread;
+
+// Read-only device that produces a tar archive (zstd-compressed when built
+// with EZ_HAVE_ZSTD) of a set of files and directories on the fly. The
+// archive is generated on a private producer thread into blocks taken from
+// the shared BufferPool and consumed by readData(), so compression is
+// pipelined with the network send and nothing is written to a temporary
+// file. The producer stalls when the pool or its own queue is full; the
+// consumer never does: readData() returns 0 when nothing is queued yet and
+// readyRead follows (queued onto the device's thread) once there is. The
+// device is sequential, so it has to be sent with an explicit
+// Content-Length (QHttpMultiPart reads a 0 as the end of the body).
+//
+// QNetworkAccessManager only streams bodies with a known length, so the
+// producer first runs a dry pass that only counts output bytes. zstd output
+// is deterministic for identical input and parameters; if a source file
+// changes between the passes the stream fails rather than sending a body
+// that does not match the advertised size.
+class ArchiveStream : public QIODevice {
+    Q_OBJECT
+
+public:
+    // The dry pass stops and fails as soon as the archive outgrows maxSize
+    ArchiveStream(const QStringList& sourcePaths, std::shared_ptr<BufferPool> pool,
+                  qint64 maxSize, QObject *parent = nullptr);
+    ~ArchiveStream() override;
+
+    // Begins enumeration and sizing; emits sizeKnown() or failed()
+    void start();
+
+    QStringList memberNames() const { return m_memberNames; }
+    qint64 uncompressedSize() const { return m_tarSize; }
+
+    bool isSequential() const override { return true; }
+    qint64 size() const override { return m_archiveSize; }
+
+    static bool isCompressed();
+    static QString fileExtension();
+    static QString mimeType();
+
+signals:
+    void sizeKnown(qint64 size);
+    void failed(const QString& message);
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    using Sink = std::function<bool(const char*, qint64)>;
+
+    void run();
+    bool collectMembers();
+    bool writeArchive(const Sink& sink, BufferPool::Block& readBuffer, BufferPool::Block& compressBuffer);
+    bool writeTar(const Sink& sink, BufferPool::Block& readBuffer);
+    bool pushOutput(const char* data, qint64 size);
+    bool flushOutput(bool needMore);
+    void finishProducing(const QString& error = QString());
+    // Called with m_mutex held
+    void notifyReader();
+
+    struct Member {
+        QString filePath;
+        QByteArray name;
+        qint64 size = 0;
+        qint64 mtime = 0;
+    };
+
+    // Per-stream cap on top of the global budget (4 MiB with 256 KiB blocks)
+    static constexpr size_t MaxQueuedBlocks = 16;
+
+    QStringList m_sourcePaths;
+    std::shared_ptr<BufferPool> m_pool;
+    qint64 m_maxSize = 0;
+    QList<Member> m_members;
+    QStringList m_memberNames;
+    qint64 m_tarSize = 0;
+    std::atomic<qint64> m_archiveSize{-1};
+
+    QThread* m_producer = nullptr;
+    std::atomic<bool> m_cancelled{false};
+
+    // Block being filled by the producer thread
+    BufferPool::Block m_output;
+    qint64 m_produced = 0;
+    bool m_overrun = false;
+
+    // Producer -> consumer hand-off, guarded by m_mutex
+    QMutex m_mutex;
+    QWaitCondition m_spaceAvailable;
+    std::deque<BufferPool::Block> m_chunks;
+    bool m_readerWaiting = false;
+    bool m_finished = false;
+    QString m_error;
+};
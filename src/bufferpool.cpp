@@ -0,0 +1,140 @@
+#include "bufferpool.h"
+#include <QDeadlineTimer>
+
+BufferPool::Block::Block(std::shared_ptr<BufferPool> pool, char* data)
+    : m_pool(std::move(pool))
+    , m_data(data)
+{
+}
+
+BufferPool::Block::Block(Block&& other) noexcept
+    : size(other.size)
+    , offset(other.offset)
+    , m_pool(std::move(other.m_pool))
+    , m_data(other.m_data)
+{
+    other.m_data = nullptr;
+    other.size = 0;
+    other.offset = 0;
+}
+
+BufferPool::Block& BufferPool::Block::operator=(Block&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_pool = std::move(other.m_pool);
+        m_data = other.m_data;
+        size = other.size;
+        offset = other.offset;
+        other.m_data = nullptr;
+        other.size = 0;
+        other.offset = 0;
+    }
+    return *this;
+}
+
+BufferPool::Block::~Block()
+{
+    release();
+}
+
+void BufferPool::Block::release()
+{
+    if (m_data) {
+        m_pool->giveBack(m_data);
+        m_data = nullptr;
+    }
+    m_pool.reset();
+    size = 0;
+    offset = 0;
+}
+
+std::shared_ptr<BufferPool> BufferPool::create(qint64 budgetBytes)
+{
+    return std::shared_ptr<BufferPool>(new BufferPool(budgetBytes));
+}
+
+BufferPool::BufferPool(qint64 budgetBytes)
+    : m_budget(qMax(budgetBytes, MinimumBudget))
+{
+}
+
+BufferPool::~BufferPool()
+{
+    for (char* data : std::as_const(m_freeBlocks)) {
+        delete[] data;
+    }
+}
+
+BufferPool::Block BufferPool::acquire(const std::atomic<bool>* cancelled)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_inUse + BlockSize > m_budget) {
+        if (cancelled && *cancelled) return Block();
+
+        // Bounded wait so a cancelled caller is noticed without a wake-up
+        m_released.wait(&m_mutex, QDeadlineTimer(100));
+    }
+    return takeLocked();
+}
+
+std::vector<BufferPool::Block> BufferPool::acquire(int count, const std::atomic<bool>* cancelled)
+{
+    Q_ASSERT(count * BlockSize <= MinimumBudget);
+    std::vector<Block> blocks;
+
+    // All-or-nothing, so stages that take their working set here can never
+    // starve each other; tryAcquire() callers must bound what they hold
+    QMutexLocker locker(&m_mutex);
+    while (m_inUse + count * BlockSize > m_budget) {
+        if (cancelled && *cancelled) return blocks;
+        m_released.wait(&m_mutex, QDeadlineTimer(100));
+    }
+    blocks.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        blocks.push_back(takeLocked());
+    }
+    return blocks;
+}
+
+BufferPool::Block BufferPool::tryAcquire()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_inUse + BlockSize > m_budget) return Block();
+    return takeLocked();
+}
+
+BufferPool::Block BufferPool::takeLocked()
+{
+    char* data = m_freeBlocks.isEmpty() ? new char[BlockSize] : m_freeBlocks.takeLast();
+
+    m_inUse += BlockSize;
+    if (m_inUse > m_peak) {
+        m_peak = qint64(m_inUse);
+    }
+    return Block(shared_from_this(), data);
+}
+
+void BufferPool::giveBack(char* data)
+{
+    QMutexLocker locker(&m_mutex);
+    m_inUse -= BlockSize;
+
+    // Keep recycled blocks only up to the budget so shrinking it frees memory
+    if (m_inUse + qint64(m_freeBlocks.size() + 1) * BlockSize <= m_budget) {
+        m_freeBlocks.append(data);
+    } else {
+        delete[] data;
+    }
+    m_released.wakeAll();
+}
+
+void BufferPool::setBudget(qint64 budgetBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_budget = qMax(budgetBytes, MinimumBudget);
+    while (!m_freeBlocks.isEmpty() && m_inUse + qint64(m_freeBlocks.size()) * BlockSize > m_budget) {
+        delete[] m_freeBlocks.takeLast();
+    }
+    m_released.wakeAll();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Fixed-size block allocator that enforces a global memory budget for the
+// upload pipeline. Stages that read, compress or buffer data take blocks
+// from here; when the budget is exhausted acquire() blocks (worker
+// threads) and tryAcquire() returns an empty block (event-loop code, which
+// should pause and retry), giving backpressure instead of unbounded growth.
+// Only acquire(count) is deadlock-free by construction; event-loop code
+// that keeps tryAcquire() blocks while waiting must cap its own share.
+//
+// Blocks keep the pool alive, so they may outlive the object that created
+// the pool and be released from any thread.
+class BufferPool : public std::enable_shared_from_this<BufferPool> {
+public:
+    static constexpr qint64 BlockSize = 256 * 1024;
+
+    // Enough for any single stage's working set, so every stage can run
+    static constexpr qint64 MinimumBudget = 4 * BlockSize;
+
+    class Block {
+    public:
+        Block() = default;
+        Block(Block&& other) noexcept;
+        Block& operator=(Block&& other) noexcept;
+        Block(const Block&) = delete;
+        Block& operator=(const Block&) = delete;
+        ~Block();
+
+        bool isNull() const { return m_data == nullptr; }
+        char* data() { return m_data; }
+        const char* constData() const { return m_data; }
+        static constexpr qint64 capacity() { return BlockSize; }
+
+        // Payload bookkeeping for stages that hand blocks downstream
+        qint64 size = 0;
+        qint64 offset = 0;
+
+    private:
+        friend class BufferPool;
+        Block(std::shared_ptr<BufferPool> pool, char* data);
+        void release();
+
+        std::shared_ptr<BufferPool> m_pool;
+        char* m_data = nullptr;
+    };
+
+    static std::shared_ptr<BufferPool> create(qint64 budgetBytes);
+    ~BufferPool();
+
+    // Waits until a block is free; returns an empty block if cancelled
+    Block acquire(const std::atomic<bool>* cancelled = nullptr);
+    std::vector<Block> acquire(int count, const std::atomic<bool>* cancelled = nullptr);
+    Block tryAcquire();
+
+    void setBudget(qint64 budgetBytes);
+    qint64 budget() const { return m_budget; }
+    qint64 bytesInUse() const { return m_inUse; }
+    qint64 peakBytesInUse() const { return m_peak; }
+
+private:
+    explicit BufferPool(qint64 budgetBytes);
+    Block takeLocked();
+    void giveBack(char* data);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_released;
+    QList<char*> m_freeBlocks;
+    std::atomic<qint64> m_budget;
+    std::atomic<qint64> m_inUse{0};
+    std::atomic<qint64> m_peak{0};
+};
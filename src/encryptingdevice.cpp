@@ -0,0 +1,298 @@
+#include "encryptingdevice.h"
+#include <QRandomGenerator>
+#include <QtEndian>
+#include <cstring>
+#include <memory>
+
+#ifdef EZ_HAVE_OPENSSL
+#include <openssl/evp.h>
+#endif
+
+namespace {
+
+constexpr char Magic[4] = {'E', 'Z', 'E', '1'};
+
+int cipherId(const QString& cipher)
+{
+    if (cipher == "aes-256-gcm") return 1;
+    if (cipher == "chacha20-poly1305") return 2;
+    return 0;
+}
+
+qint64 chunkCountFor(qint64 plainSize)
+{
+    // An empty source still gets one (empty, authenticated) final chunk
+    return qMax<qint64>(1, (plainSize + EncryptingDevice::ChunkSize - 1) / EncryptingDevice::ChunkSize);
+}
+
+QByteArray makeHeader(int id, qint64 plainSize)
+{
+    QByteArray header(EncryptingDevice::HeaderSize, '\0');
+    std::memcpy(header.data(), Magic, 4);
+    header[4] = char(id);
+    qToBigEndian<quint32>(quint32(EncryptingDevice::ChunkSize), header.data() + 8);
+    qToBigEndian<quint64>(quint64(plainSize), header.data() + 12);
+    return header;
+}
+
+QByteArray makeNonce(qint64 index, bool last)
+{
+    QByteArray nonce(12, '\0');
+    // Chunk index in bytes 4..10 (big-endian), last-chunk flag in byte 11
+    qToBigEndian<quint64>(quint64(index), nonce.data() + 3);
+    nonce[3] = 0;
+    nonce[11] = last ? 1 : 0;
+    return nonce;
+}
+
+#ifdef EZ_HAVE_OPENSSL
+const EVP_CIPHER* evpCipher(int id)
+{
+    switch (id) {
+    case 1: return EVP_aes_256_gcm();
+    case 2: return EVP_chacha20_poly1305();
+    default: return nullptr;
+    }
+}
+
+using CipherContext = std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)>;
+
+// Seals plain into out (ciphertext followed by the tag)
+bool sealChunk(int id, const QByteArray& key, const QByteArray& nonce, const QByteArray& aad,
+               const char* plain, int plainSize, char* out)
+{
+    CipherContext ctx(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
+    auto* o = reinterpret_cast<unsigned char*>(out);
+    int n = 0;
+    int tail = 0;
+    return ctx &&
+           EVP_EncryptInit_ex(ctx.get(), evpCipher(id), nullptr,
+                              reinterpret_cast<const unsigned char*>(key.constData()),
+                              reinterpret_cast<const unsigned char*>(nonce.constData())) == 1 &&
+           EVP_EncryptUpdate(ctx.get(), nullptr, &n,
+                             reinterpret_cast<const unsigned char*>(aad.constData()), int(aad.size())) == 1 &&
+           EVP_EncryptUpdate(ctx.get(), o, &n,
+                             reinterpret_cast<const unsigned char*>(plain), plainSize) == 1 &&
+           EVP_EncryptFinal_ex(ctx.get(), o + n, &tail) == 1 &&
+           EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_AEAD_GET_TAG, int(EncryptingDevice::TagSize),
+                               o + plainSize) == 1;
+}
+
+bool openChunk(int id, const QByteArray& key, const QByteArray& nonce, const QByteArray& aad,
+               const char* sealed, int plainSize, char* out)
+{
+    CipherContext ctx(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
+    auto* o = reinterpret_cast<unsigned char*>(out);
+    QByteArray tag(sealed + plainSize, EncryptingDevice::TagSize);
+    int n = 0;
+    int tail = 0;
+    return ctx &&
+           EVP_DecryptInit_ex(ctx.get(), evpCipher(id), nullptr,
+                              reinterpret_cast<const unsigned char*>(key.constData()),
+                              reinterpret_cast<const unsigned char*>(nonce.constData())) == 1 &&
+           EVP_DecryptUpdate(ctx.get(), nullptr, &n,
+                             reinterpret_cast<const unsigned char*>(aad.constData()), int(aad.size())) == 1 &&
+           EVP_DecryptUpdate(ctx.get(), o, &n,
+                             reinterpret_cast<const unsigned char*>(sealed), plainSize) == 1 &&
+           EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_AEAD_SET_TAG, int(tag.size()), tag.data()) == 1 &&
+           EVP_DecryptFinal_ex(ctx.get(), o + n, &tail) == 1;
+}
+#endif
+
+} // namespace
+
+EncryptingDevice::EncryptingDevice(QIODevice* source, const QString& cipher, const QByteArray& key,
+                                   QObject *parent)
+    : QIODevice(parent)
+    , m_source(source)
+    , m_cipherId(cipherId(cipher))
+    , m_key(key)
+    , m_plainSize(source->size())
+    , m_chunkCount(chunkCountFor(source->size()))
+{
+    m_source->setParent(this);
+    m_header = makeHeader(m_cipherId, m_plainSize);
+    connect(m_source, &QIODevice::readyRead, this, &QIODevice::readyRead);
+
+    if (isAvailable() && m_cipherId != 0 && m_key.size() == KeySize) {
+        // Unbuffered so QIODevice's position matches m_position
+        open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    } else {
+        setErrorString("Encryption is not available");
+    }
+}
+
+bool EncryptingDevice::isAvailable()
+{
+#ifdef EZ_HAVE_OPENSSL
+    return true;
+#else
+    return false;
+#endif
+}
+
+QStringList EncryptingDevice::ciphers()
+{
+    return {"aes-256-gcm", "chacha20-poly1305"};
+}
+
+QByteArray EncryptingDevice::generateKey()
+{
+    QByteArray key(KeySize, '\0');
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(key.data()), KeySize / 4);
+    return key;
+}
+
+qint64 EncryptingDevice::encryptedSize(qint64 plainSize)
+{
+    return HeaderSize + plainSize + chunkCountFor(plainSize) * TagSize;
+}
+
+bool EncryptingDevice::isSequential() const
+{
+    return m_source->isSequential();
+}
+
+qint64 EncryptingDevice::size() const
+{
+    return encryptedSize(m_plainSize);
+}
+
+bool EncryptingDevice::seek(qint64 pos)
+{
+    // Any chunk can be re-sealed from a seekable source; the same key and
+    // nonce give the same bytes, so QNAM may rewind and resend
+    if (isSequential() || pos < 0 || pos > size()) return false;
+
+    m_position = pos;
+    return QIODevice::seek(pos);
+}
+
+EncryptingDevice::LoadResult EncryptingDevice::loadChunk(qint64 index)
+{
+#ifdef EZ_HAVE_OPENSSL
+    const qint64 offset = index * ChunkSize;
+    const int length = int(qMin(ChunkSize, m_plainSize - offset));
+
+    if (isSequential()) {
+        if (index != m_chunkIndex + 1) return LoadResult::Failed;
+    } else {
+        m_plainFilled = 0;
+        if (m_source->pos() != offset && !m_source->seek(offset)) return LoadResult::Failed;
+    }
+
+    // A sequential source (a streamed archive) may have nothing yet; keep
+    // what was gathered and continue on its next readyRead
+    m_plain.resize(length);
+    while (m_plainFilled < length) {
+        const qint64 n = m_source->read(m_plain.data() + m_plainFilled, length - m_plainFilled);
+        if (n == 0 && isSequential()) return LoadResult::Waiting;
+        if (n <= 0) {
+            setErrorString("Failed to read the file being encrypted");
+            return LoadResult::Failed;
+        }
+        m_plainFilled += n;
+    }
+    m_plainFilled = 0;
+
+    m_chunk.resize(length + TagSize);
+    if (!sealChunk(m_cipherId, m_key, makeNonce(index, index == m_chunkCount - 1), m_header,
+                   m_plain.constData(), length, m_chunk.data())) {
+        setErrorString("Encryption failed");
+        return LoadResult::Failed;
+    }
+
+    m_chunkIndex = index;
+    return LoadResult::Loaded;
+#else
+    Q_UNUSED(index);
+    return LoadResult::Failed;
+#endif
+}
+
+qint64 EncryptingDevice::readData(char* data, qint64 maxSize)
+{
+    const qint64 total = size();
+    qint64 copied = 0;
+
+    while (copied < maxSize && m_position < total) {
+        qint64 n = 0;
+        if (m_position < HeaderSize) {
+            n = qMin(maxSize - copied, HeaderSize - m_position);
+            std::memcpy(data + copied, m_header.constData() + m_position, size_t(n));
+        } else {
+            const qint64 relative = m_position - HeaderSize;
+            const qint64 index = relative / (ChunkSize + TagSize);
+            const qint64 offset = relative % (ChunkSize + TagSize);
+            if (index != m_chunkIndex) {
+                const LoadResult result = loadChunk(index);
+                if (result == LoadResult::Waiting) break;
+                if (result == LoadResult::Failed) return copied > 0 ? copied : -1;
+            }
+            n = qMin(maxSize - copied, m_chunk.size() - offset);
+            std::memcpy(data + copied, m_chunk.constData() + offset, size_t(n));
+        }
+        copied += n;
+        m_position += n;
+    }
+
+    if (copied == 0 && m_position >= total) {
+        return -1;
+    }
+    return copied;
+}
+
+qint64 EncryptingDevice::writeData(const char*, qint64)
+{
+    return -1;
+}
+
+qint64 EncryptingDevice::decrypt(qint64 encryptedSize, const Reader& read, const Writer& write,
+                                 const QByteArray& key, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return qint64(-1);
+    };
+
+#ifdef EZ_HAVE_OPENSSL
+    QByteArray header(HeaderSize, Qt::Uninitialized);
+    if (encryptedSize < HeaderSize || !read(header.data(), HeaderSize) ||
+        std::memcmp(header.constData(), Magic, 4) != 0) {
+        return fail("Not an encrypted upload");
+    }
+    if (key.size() != KeySize) {
+        return fail("Invalid key");
+    }
+
+    const int id = header[4];
+    const qint64 chunkSize = qFromBigEndian<quint32>(header.constData() + 8);
+    const qint64 plainSize = qint64(qFromBigEndian<quint64>(header.constData() + 12));
+    if (!evpCipher(id) || chunkSize != ChunkSize || plainSize < 0 ||
+        encryptedSize != EncryptingDevice::encryptedSize(plainSize)) {
+        return fail("Unsupported or truncated encrypted upload");
+    }
+
+    QByteArray sealed(ChunkSize + TagSize, Qt::Uninitialized);
+    QByteArray plain(ChunkSize, Qt::Uninitialized);
+    const qint64 chunks = chunkCountFor(plainSize);
+    for (qint64 index = 0; index < chunks; ++index) {
+        const int length = int(qMin(ChunkSize, plainSize - index * ChunkSize));
+        if (!read(sealed.data(), length + TagSize)) {
+            return fail("Unsupported or truncated encrypted upload");
+        }
+        if (!openChunk(id, key, makeNonce(index, index == chunks - 1), header,
+                       sealed.constData(), length, plain.data())) {
+            return fail("Decryption failed: wrong key or corrupted data");
+        }
+        write(plain.constData(), length);
+    }
+    return plainSize;
+#else
+    Q_UNUSED(encryptedSize);
+    Q_UNUSED(read);
+    Q_UNUSED(write);
+    Q_UNUSED(key);
+    return fail("Built without encryption support");
+#endif
+}
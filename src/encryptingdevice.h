@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+// Pass-through device that encrypts its source with an AEAD cipher
+// (AES-256-GCM or ChaCha20-Poly1305 through OpenSSL, which picks AES-NI /
+// SIMD code paths on its own) while the upload reads it, so there is no
+// separate encryption pass and memory stays at one chunk regardless of
+// file size. The output is:
+//
+//     header (20 bytes: "EZE1", cipher id, 3 reserved, chunk size and
+//             plaintext size, both big-endian)
+//     chunk 0 ciphertext + 16-byte tag
+//     chunk 1 ...
+//
+// Every chunk is sealed separately with the header as associated data and
+// a nonce made of its index and a last-chunk flag, so chunks cannot be
+// reordered, dropped or truncated. Keys are random per file, which makes
+// the counter nonce safe. The output size is known up front.
+class EncryptingDevice : public QIODevice {
+    Q_OBJECT
+
+public:
+    static constexpr qint64 ChunkSize = 64 * 1024;
+    static constexpr qint64 TagSize = 16;
+    static constexpr qint64 HeaderSize = 20;
+    static constexpr int KeySize = 32;
+
+    // Takes ownership of source, which must already be open for reading.
+    // The device is only open if the cipher and key are usable.
+    EncryptingDevice(QIODevice* source, const QString& cipher, const QByteArray& key,
+                     QObject *parent = nullptr);
+
+    // False when built without OpenSSL
+    static bool isAvailable();
+    static QStringList ciphers();
+    static QByteArray generateKey();
+    static qint64 encryptedSize(qint64 plainSize);
+    // Reverses a stream of encryptedSize bytes one chunk at a time, so the
+    // data need not be contiguous: read fills the next n ciphertext bytes
+    // and write receives the plaintext in order, never ahead of what was
+    // read. Returns the plaintext size, or -1 on any authentication failure
+    // (plaintext already written must then be discarded).
+    using Reader = std::function<bool(char* data, qint64 size)>;
+    using Writer = std::function<void(const char* data, qint64 size)>;
+    static qint64 decrypt(qint64 encryptedSize, const Reader& read, const Writer& write,
+                          const QByteArray& key, QString* error = nullptr);
+
+    bool isSequential() const override;
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    enum class LoadResult { Loaded, Waiting, Failed };
+    LoadResult loadChunk(qint64 index);
+
+    QIODevice* m_source;
+    int m_cipherId = 0;
+    QByteArray m_key;
+    QByteArray m_header;
+    qint64 m_plainSize = 0;
+    qint64 m_chunkCount = 0;
+
+    // Output stream position, tracked here since sequential devices have none
+    qint64 m_position = 0;
+    // Sealed chunk currently being served, and a scratch plaintext buffer
+    qint64 m_chunkIndex = -1;
+    QByteArray m_chunk;
+    QByteArray m_plain;
+    // Plaintext of the next chunk gathered so far from a sequential source
+    qint64 m_plainFilled = 0;
+};
@@ -0,0 +1,95 @@
+#include "eventloopmonitor.h"
+#include <QCoreApplication>
+#include <QEvent>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const QEvent::Type ProbeEventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+// Carries the time it was posted at
+class ProbeEvent : public QEvent {
+public:
+    explicit ProbeEvent(qint64 postedNs)
+        : QEvent(ProbeEventType)
+        , postedNs(postedNs)
+    {
+    }
+
+    qint64 postedNs;
+};
+
+} // namespace
+
+EventLoopMonitor::EventLoopMonitor(QWidget* paintTarget, QObject *parent)
+    : QObject(parent)
+    , m_paintTarget(paintTarget)
+{
+    m_lagTimer.setTimerType(Qt::PreciseTimer);
+    m_lagTimer.setInterval(LagInterval);
+    connect(&m_lagTimer, &QTimer::timeout, this, [this]() {
+        const qint64 now = m_clock.nsecsElapsed();
+        const double late = (now - m_lastTick) / 1e6 - LagInterval;
+        m_lag.push_back(std::max(late, 0.0));
+        m_lastTick = now;
+    });
+
+    m_inputTimer.setInterval(InputInterval);
+    connect(&m_inputTimer, &QTimer::timeout, this, [this]() {
+        QCoreApplication::postEvent(this, new ProbeEvent(m_clock.nsecsElapsed()));
+    });
+
+    m_paintTimer.setInterval(PaintInterval);
+    connect(&m_paintTimer, &QTimer::timeout, this, [this]() {
+        if (!m_paintTarget || !m_paintTarget->isVisible()) return;
+
+        const qint64 before = m_clock.nsecsElapsed();
+        m_paintTarget->repaint();
+        m_paintTime.push_back((m_clock.nsecsElapsed() - before) / 1e6);
+    });
+}
+
+void EventLoopMonitor::start()
+{
+    m_clock.start();
+    m_lastTick = 0;
+    m_lagTimer.start();
+    m_inputTimer.start();
+    m_paintTimer.start();
+}
+
+void EventLoopMonitor::stop()
+{
+    m_lagTimer.stop();
+    m_inputTimer.stop();
+    m_paintTimer.stop();
+}
+
+void EventLoopMonitor::customEvent(QEvent* event)
+{
+    if (event->type() != ProbeEventType) return;
+
+    const auto* probe = static_cast<ProbeEvent*>(event);
+    m_inputLatency.push_back((m_clock.nsecsElapsed() - probe->postedNs) / 1e6);
+}
+
+EventLoopMonitor::Summary EventLoopMonitor::summarize(std::vector<double> samples)
+{
+    Summary summary;
+    summary.samples = samples.size();
+    if (samples.empty()) return summary;
+
+    std::sort(samples.begin(), samples.end());
+
+    // Nearest-rank percentiles
+    auto percentile = [&samples](double p) {
+        const size_t rank = size_t(std::ceil(p / 100.0 * samples.size()));
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    };
+    summary.p50 = percentile(50);
+    summary.p95 = percentile(95);
+    summary.p99 = percentile(99);
+    summary.max = samples.back();
+    return summary;
+}
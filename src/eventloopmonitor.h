@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QWidget>
+#include <vector>
+
+// Samples how responsive the thread it lives on is:
+//  - lag: how late a 5 ms precise timer fires
+//  - input latency: delay between posting an event and its delivery, the
+//    path real mouse and key events take through the queue
+//  - paint time: duration of a synchronous repaint of the watched widget
+// Timers and posted events are also serviced by nested loops such as
+// QMessageBox::exec(), so modal prompts are measured like everything else.
+class EventLoopMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    struct Summary {
+        size_t samples = 0;
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+        double max = 0;
+    };
+
+    explicit EventLoopMonitor(QWidget* paintTarget = nullptr, QObject *parent = nullptr);
+
+    void start();
+    void stop();
+
+    // All values in milliseconds
+    Summary lag() const { return summarize(m_lag); }
+    Summary inputLatency() const { return summarize(m_inputLatency); }
+    Summary paintTime() const { return summarize(m_paintTime); }
+
+protected:
+    void customEvent(QEvent* event) override;
+
+private:
+    static Summary summarize(std::vector<double> samples);
+
+    static constexpr int LagInterval = 5;
+    static constexpr int InputInterval = 20;
+    static constexpr int PaintInterval = 100;
+
+    QPointer<QWidget> m_paintTarget;
+    QElapsedTimer m_clock;
+    QTimer m_lagTimer;
+    QTimer m_inputTimer;
+    QTimer m_paintTimer;
+    qint64 m_lastTick = 0;
+
+    std::vector<double> m_lag;
+    std::vector<double> m_inputLatency;
+    std::vector<double> m_paintTime;
+};
@@ -0,0 +1,198 @@
+#include "fanoutbuffer.h"
+#include <cstring>
+#include <utility>
+
+FanOutBuffer::FanOutBuffer(QIODevice* source, std::shared_ptr<BufferPool> pool)
+    : m_source(source)
+    , m_sourceSize(source->size())
+    , m_pool(std::move(pool))
+{
+    m_source->setParent(this);
+    // A sequential source (a streamed archive) may run dry for a while
+    connect(m_source, &QIODevice::readyRead, this, &FanOutBuffer::wakeWaiting);
+
+    m_retryTimer.setSingleShot(true);
+    m_retryTimer.setInterval(50);
+    connect(&m_retryTimer, &QTimer::timeout, this, &FanOutBuffer::wakeWaiting);
+}
+
+FanOutBuffer::~FanOutBuffer()
+{
+    // Readers keep the buffer alive, so none can be left at this point
+    m_blocks.clear();
+}
+
+FanOutReader* FanOutBuffer::createReader(const QByteArray& prefix, const QByteArray& suffix)
+{
+    auto* reader = new FanOutReader(shared_from_this(), prefix, suffix);
+    m_readers.append(reader);
+    return reader;
+}
+
+qint64 FanOutBuffer::read(FanOutReader* reader, qint64 position, char* data, qint64 maxSize)
+{
+    if (position >= m_end && !fill()) {
+        if (!m_error.isEmpty()) return -1;
+        if (!m_waiting.contains(reader)) {
+            m_waiting.append(reader);
+        }
+        return 0;
+    }
+
+    // Copy out of the blocks covering [position, m_end)
+    qint64 copied = 0;
+    qint64 blockStart = m_start;
+    for (const BufferPool::Block& block : m_blocks) {
+        if (copied == maxSize) break;
+        const qint64 blockEnd = blockStart + block.size;
+        if (position + copied < blockEnd) {
+            const qint64 offset = position + copied - blockStart;
+            const qint64 n = qMin(maxSize - copied, block.size - offset);
+            std::memcpy(data + copied, block.constData() + offset, size_t(n));
+            copied += n;
+        }
+        blockStart = blockEnd;
+    }
+    return copied;
+}
+
+bool FanOutBuffer::fill()
+{
+    if (m_end >= m_sourceSize || !m_error.isEmpty()) return false;
+
+    trim();
+    if (m_blocks.empty() || m_blocks.back().size == BufferPool::BlockSize) {
+        if (int(m_blocks.size()) >= MaxBlocks) {
+            return false;  // the slowest reader has to catch up first
+        }
+        BufferPool::Block block = m_pool->tryAcquire();
+        if (block.isNull()) {
+            m_retryTimer.start();
+            return false;
+        }
+        m_blocks.push_back(std::move(block));
+    }
+
+    BufferPool::Block& block = m_blocks.back();
+    const qint64 wanted = qMin(BufferPool::BlockSize - block.size, m_sourceSize - m_end);
+    const qint64 n = m_source->read(block.data() + block.size, wanted);
+    if (n == 0 && m_source->isSequential()) {
+        return false;  // woken through the source's readyRead
+    }
+    if (n <= 0) {
+        m_error = m_source->errorString().isEmpty() ? QString("Source ended early") : m_source->errorString();
+        wakeWaiting();
+        return false;
+    }
+
+    block.size += n;
+    m_end += n;
+    wakeWaiting();
+    return true;
+}
+
+void FanOutBuffer::trim()
+{
+    qint64 oldest = m_end;
+    for (const FanOutReader* reader : std::as_const(m_readers)) {
+        oldest = qMin(oldest, reader->sourcePosition());
+    }
+
+    bool freed = false;
+    while (!m_blocks.empty() && m_blocks.front().size == BufferPool::BlockSize &&
+           m_start + m_blocks.front().size <= oldest) {
+        m_start += m_blocks.front().size;
+        m_blocks.pop_front();  // back to the pool
+        freed = true;
+    }
+
+    if (freed) {
+        wakeWaiting();
+    }
+}
+
+void FanOutBuffer::wakeWaiting()
+{
+    // Queued so a reader is never re-entered from another reader's read()
+    const QList<FanOutReader*> waiting = std::exchange(m_waiting, {});
+    for (FanOutReader* reader : waiting) {
+        QMetaObject::invokeMethod(reader, [reader]() {
+            emit reader->readyRead();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void FanOutBuffer::detach(FanOutReader* reader)
+{
+    m_readers.removeOne(reader);
+    m_waiting.removeOne(reader);
+    trim();
+}
+
+FanOutReader::FanOutReader(std::shared_ptr<FanOutBuffer> buffer, const QByteArray& prefix,
+                           const QByteArray& suffix)
+    : m_buffer(std::move(buffer))
+    , m_prefix(prefix)
+    , m_suffix(suffix)
+{
+    open(QIODevice::ReadOnly);
+}
+
+FanOutReader::~FanOutReader()
+{
+    m_buffer->detach(this);
+}
+
+qint64 FanOutReader::size() const
+{
+    return m_prefix.size() + m_buffer->sourceSize() + m_suffix.size();
+}
+
+qint64 FanOutReader::bytesAvailable() const
+{
+    return QIODevice::bytesAvailable() + qMax<qint64>(m_buffer->m_end - sourcePosition(), 0);
+}
+
+qint64 FanOutReader::sourcePosition() const
+{
+    return qBound<qint64>(0, m_position - m_prefix.size(), m_buffer->sourceSize());
+}
+
+qint64 FanOutReader::readData(char* data, qint64 maxSize)
+{
+    const qint64 sourceEnd = m_prefix.size() + m_buffer->sourceSize();
+    qint64 copied = 0;
+
+    while (copied < maxSize && m_position < size()) {
+        qint64 n = 0;
+        if (m_position < m_prefix.size()) {
+            n = qMin(maxSize - copied, m_prefix.size() - m_position);
+            std::memcpy(data + copied, m_prefix.constData() + m_position, size_t(n));
+        } else if (m_position < sourceEnd) {
+            n = m_buffer->read(this, sourcePosition(), data + copied, maxSize - copied);
+            if (n < 0) {
+                setErrorString(m_buffer->m_error);
+                return -1;
+            }
+            if (n == 0) break;  // woken through readyRead when data is ready
+        } else {
+            const qint64 offset = m_position - sourceEnd;
+            n = qMin(maxSize - copied, m_suffix.size() - offset);
+            std::memcpy(data + copied, m_suffix.constData() + offset, size_t(n));
+        }
+        copied += n;
+        m_position += n;
+    }
+
+    if (copied > 0) {
+        m_buffer->trim();
+    } else if (m_position >= size()) {
+        return -1;
+    }
+    return copied;
+}
+
+qint64 FanOutReader::writeData(const char*, qint64)
+{
+    return -1;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "bufferpool.h"
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+#include <deque>
+#include <memory>
+
+class FanOutReader;
+
+// Reads a source device once and serves the bytes to any number of
+// readers through a ring of pool blocks, so an upload to several
+// destinations costs one pass of disk I/O (and hashing, when the source is
+// a HashingDevice). The ring only advances as fast as the slowest reader:
+// a reader that runs ahead gets no data (read() returns 0) and is sent
+// readyRead once the others catch up. Everything runs on the thread that
+// owns the buffer; nothing blocks.
+class FanOutBuffer : public QObject, public std::enable_shared_from_this<FanOutBuffer> {
+    Q_OBJECT
+
+public:
+    // Takes ownership of source, which must be open and report its size
+    FanOutBuffer(QIODevice* source, std::shared_ptr<BufferPool> pool);
+    ~FanOutBuffer() override;
+
+    // Each reader streams prefix, the source bytes and suffix; the
+    // envelope lets one reader carry the multipart framing of a form post.
+    // All readers should be created before any of them is read from.
+    FanOutReader* createReader(const QByteArray& prefix = QByteArray(),
+                               const QByteArray& suffix = QByteArray());
+
+    QIODevice* source() const { return m_source; }
+    qint64 sourceSize() const { return m_sourceSize; }
+
+private:
+    friend class FanOutReader;
+
+    qint64 read(FanOutReader* reader, qint64 position, char* data, qint64 maxSize);
+    bool fill();
+    void trim();
+    void wakeWaiting();
+    void detach(FanOutReader* reader);
+
+    // Limits how far the fastest reader can get ahead of the slowest
+    static constexpr int MaxBlocks = 8;
+
+    QIODevice* m_source;
+    qint64 m_sourceSize;
+    std::shared_ptr<BufferPool> m_pool;
+
+    // Source bytes [m_start, m_end) held in m_blocks
+    std::deque<BufferPool::Block> m_blocks;
+    qint64 m_start = 0;
+    qint64 m_end = 0;
+    QString m_error;
+
+    QList<FanOutReader*> m_readers;
+    QList<FanOutReader*> m_waiting;
+    // Retries a fill that found the memory budget exhausted
+    QTimer m_retryTimer;
+};
+
+// Sequential device handed to QNAM for one destination; the size is known
+// up front so the request can carry a Content-Length and stream.
+class FanOutReader : public QIODevice {
+    Q_OBJECT
+
+public:
+    ~FanOutReader() override;
+
+    bool isSequential() const override { return true; }
+    qint64 size() const override;
+    qint64 bytesAvailable() const override;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    friend class FanOutBuffer;
+    FanOutReader(std::shared_ptr<FanOutBuffer> buffer, const QByteArray& prefix, const QByteArray& suffix);
+
+    // Offset into the source, for the buffer to know what can be dropped
+    qint64 sourcePosition() const;
+
+    std::shared_ptr<FanOutBuffer> m_buffer;
+    QByteArray m_prefix;
+    QByteArray m_suffix;
+    qint64 m_position = 0;
+};
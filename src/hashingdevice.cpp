@@ -0,0 +1,65 @@
+#include "hashingdevice.h"
+
+HashingDevice::HashingDevice(QIODevice* source, QCryptographicHash::Algorithm algorithm,
+                             QObject *parent)
+    : QIODevice(parent)
+    , m_source(source)
+    , m_hash(algorithm)
+{
+    m_source->setParent(this);
+    // A sequential source that had no data yet announces more this way
+    connect(m_source, &QIODevice::readyRead, this, &QIODevice::readyRead);
+
+    // Unbuffered so pos() in readData() is the source offset being read
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+bool HashingDevice::isSequential() const
+{
+    return m_source->isSequential();
+}
+
+qint64 HashingDevice::size() const
+{
+    return m_source->size();
+}
+
+bool HashingDevice::seek(qint64 pos)
+{
+    return m_source->seek(pos) && QIODevice::seek(pos);
+}
+
+bool HashingDevice::reset()
+{
+    return m_source->reset() && QIODevice::reset();
+}
+
+QByteArray HashingDevice::digest() const
+{
+    if (m_gap || m_hashed != size()) {
+        return QByteArray();
+    }
+    return m_hash.result();
+}
+
+qint64 HashingDevice::readData(char* data, qint64 maxSize)
+{
+    // Sequential devices report no position; every byte is new
+    const qint64 offset = isSequential() ? m_hashed : pos();
+    const qint64 n = m_source->read(data, maxSize);
+    if (n <= 0) return n;
+
+    if (offset > m_hashed) {
+        m_gap = true;
+    } else if (offset + n > m_hashed) {
+        const qint64 skip = m_hashed - offset;
+        m_hash.addData(QByteArrayView(data + skip, n - skip));
+        m_hashed = offset + n;
+    }
+    return n;
+}
+
+qint64 HashingDevice::writeData(const char*, qint64)
+{
+    return -1;
+}
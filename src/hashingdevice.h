@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QIODevice>
+#include <QCryptographicHash>
+
+// Pass-through device that hashes the bytes of its source as they are read,
+// so the digest of an upload body is computed by the send itself instead
+// of a separate pass over the file. Re-reads after a seek back (e.g. QNAM
+// retrying a request) are only hashed past the point already covered; a
+// forward seek leaves a gap and makes the digest unavailable.
+class HashingDevice : public QIODevice {
+    Q_OBJECT
+
+public:
+    // Takes ownership of source, which must already be open for reading
+    HashingDevice(QIODevice* source, QCryptographicHash::Algorithm algorithm,
+                  QObject *parent = nullptr);
+
+    bool isSequential() const override;
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+    bool reset() override;
+
+    // Empty unless every byte of the source was read exactly once in order
+    QByteArray digest() const;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    QIODevice* m_source;
+    QCryptographicHash m_hash;
+    qint64 m_hashed = 0;
+    bool m_gap = false;
+};
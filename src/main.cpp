@@ -1,7 +1,18 @@
 #include <QApplication>
+#include <QCommandLineParser>
 #include "mainwindow.h"
+#include "stressharness.h"
+#include <algorithm>
 
 int main(int argc, char *argv[]) {
+    // The stress harness runs headless unless a platform was chosen
+    const bool stress = std::any_of(argv + 1, argv + argc, [](const char* arg) {
+        return qstrcmp(arg, "--stress") == 0;
+    });
+    if (stress && !qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    
     QApplication app(argc, argv);
     
     // Set application information
@@ -9,6 +20,44 @@ int main(int argc, char *argv[]) {
     QApplication::setOrganizationName("E-Z Uploader");
     QApplication::setApplicationVersion("1.0.0");
     
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    
+    const StressHarness::Options defaults;
+    QCommandLineOption stressOption("stress", "Run the GUI responsiveness stress test and exit.");
+    QCommandLineOption filesOption("stress-files", "Number of files to upload.", "count",
+                                   QString::number(defaults.files));
+    QCommandLineOption keysOption("stress-keys", "Number of API keys to spread uploads over.", "count",
+                                  QString::number(defaults.apiKeys));
+    QCommandLineOption timeoutOption("stress-timeout", "Seconds allowed for all uploads to finish.", "seconds",
+                                     QString::number(defaults.timeoutSeconds));
+    QCommandLineOption lagOption("max-p99-lag", "Fail if p99 event-loop lag exceeds this.", "ms",
+                                 QString::number(defaults.maxP99LagMs));
+    parser.addOptions({stressOption, filesOption, keysOption, timeoutOption, lagOption});
+    parser.process(app);
+    
+    if (parser.isSet(stressOption)) {
+        // Own journal (AppDataLocation follows the app name); settings scope below
+        QApplication::setApplicationName("E-Z Uploader Stress");
+        
+        StressHarness::Options options;
+        options.files = qMax(parser.value(filesOption).toInt(), 1);
+        options.apiKeys = qMax(parser.value(keysOption).toInt(), 1);
+        options.timeoutSeconds = qMax(parser.value(timeoutOption).toInt(), 1);
+        options.maxP99LagMs = parser.value(lagOption).toDouble();
+        
+        StressHarness harness(options);
+        if (!harness.prepare()) {
+            return 2;
+        }
+        
+        MainWindow window(StressHarness::SettingsScope);
+        window.show();
+        harness.run(&window);
+        return app.exec();
+    }
+    
     MainWindow window;
     window.show();
     
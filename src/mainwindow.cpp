@@ -1,4 +1,9 @@
 #include "mainwindow.h"
+#include "uploadengine.h"
+#include "archivestream.h"
+#include "uploadqueue.h"
+#include "mirrordestination.h"
+#include "encryptingdevice.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QPushButton>
@@ -11,13 +16,11 @@
 #include <QDropEvent>
 #include <QMimeData>
 #include <QProgressBar>
-#include <QNetworkReply>
-#include <QHttpMultiPart>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QStyle>
-#include <QUrlQuery>
 #include <QDesktopServices>
 #include <QClipboard>
 #include <QMenuBar>
@@ -25,10 +28,17 @@
 #include <QAction>
 #include <QListWidget>
 #include <QStatusBar>
+#include <QInputDialog>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QDir>
+#include <algorithm>
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(const QString& settingsScope, QWidget *parent)
     : QMainWindow(parent)
-    , m_settings("E-Z Uploader", "Settings")
+    , m_settings("E-Z Uploader", settingsScope)
 {
     setWindowTitle("E-Z Uploader");
     setMinimumSize(800, 600);
@@ -39,8 +49,22 @@ MainWindow::MainWindow(QWidget *parent)
     setStyleSheet(styleFile.readAll());
     
     setupUi();
-    
-    // Initialize API key state
+    setupUploadEngine();
+    setupUploadQueue();
+    loadExpiryQueue();
+    loadEncryptionKeys();
+    
+    // Periodically purge uploads older than the configured retention
+    m_expiryTimer.setInterval(60 * 60 * 1000);
+    connect(&m_expiryTimer, &QTimer::timeout, this, &MainWindow::expireOldUploads);
+    m_expiryTimer.start();
+    
+    // Fallback for platforms without a reachability backend
+    m_revalidateTimer.setInterval(60 * 1000);
+    connect(&m_revalidateTimer, &QTimer::timeout, this, &MainWindow::revalidateApiKey);
+    
+    // Initialize API key state; extra keys were validated when they were added
+    m_extraApiKeys = m_settings.value("extra_api_keys").toStringList();
     m_apiKey = m_settings.value("api_key").toString();
     if (!m_apiKey.isEmpty()) {
         validateApiKey(m_apiKey);
@@ -50,6 +74,72 @@ MainWindow::MainWindow(QWidget *parent)
     }
 }
 
+MainWindow::~MainWindow()
+{
+    m_networkThread.quit();
+    m_networkThread.wait();
+}
+
+void MainWindow::setupUploadEngine()
+{
+    m_uploadEngine = new UploadEngine;
+    m_uploadEngine->moveToThread(&m_networkThread);
+    connect(&m_networkThread, &QThread::finished, m_uploadEngine, &QObject::deleteLater);
+    
+    // Requests to the engine (queued onto the network thread)
+    connect(this, &MainWindow::apiKeysChanged, m_uploadEngine, &UploadEngine::setApiKeys);
+    connect(this, &MainWindow::keyRateLimitChanged, m_uploadEngine, &UploadEngine::setKeyRateLimit);
+    connect(this, &MainWindow::mirrorsChanged, m_uploadEngine, &UploadEngine::setMirrors);
+    connect(this, &MainWindow::validateApiKeyRequested, m_uploadEngine, &UploadEngine::validateApiKey);
+    connect(this, &MainWindow::uploadRequested, m_uploadEngine, &UploadEngine::upload);
+    connect(this, &MainWindow::archiveUploadRequested, m_uploadEngine, &UploadEngine::uploadArchive);
+    connect(this, &MainWindow::previewRequested, m_uploadEngine, &UploadEngine::fetchPreview);
+    connect(this, &MainWindow::deleteRequested, m_uploadEngine, &UploadEngine::deleteUploads);
+    connect(this, &MainWindow::memoryBudgetChanged, m_uploadEngine, &UploadEngine::setMemoryBudget);
+    connect(this, &MainWindow::verifyRequested, m_uploadEngine, &UploadEngine::verifyUpload);
+    connect(this, &MainWindow::verifyRateLimitChanged, m_uploadEngine, &UploadEngine::setVerifyRateLimit);
+    
+    // Results back to the GUI thread (queued)
+    connect(m_uploadEngine, &UploadEngine::apiKeyValidated, this, &MainWindow::validateApiKeyResponse);
+    connect(m_uploadEngine, &UploadEngine::apiKeyUnverified, this, &MainWindow::apiKeyUnverified);
+    connect(m_uploadEngine, &UploadEngine::apiKeyRejected, this, &MainWindow::apiKeyRejected);
+    connect(m_uploadEngine, &UploadEngine::archiveReady, this, &MainWindow::archiveReady);
+    connect(m_uploadEngine, &UploadEngine::uploadProgress, this, &MainWindow::uploadProgress);
+    connect(m_uploadEngine, &UploadEngine::uploadSucceeded, this, &MainWindow::uploadSucceeded);
+    connect(m_uploadEngine, &UploadEngine::uploadFailed, this, &MainWindow::uploadFailed);
+    connect(m_uploadEngine, &UploadEngine::previewReady, this, &MainWindow::previewImageDownloaded);
+    connect(m_uploadEngine, &UploadEngine::previewFailed, this, &MainWindow::previewImageFailed);
+    connect(m_uploadEngine, &UploadEngine::deleteFinished, this, &MainWindow::uploadDeleted);
+    connect(m_uploadEngine, &UploadEngine::memoryUsageChanged, this, &MainWindow::updateMemoryUsage);
+    connect(m_uploadEngine, &UploadEngine::verificationFinished, this, &MainWindow::verificationFinished);
+    
+    m_networkThread.setObjectName("UploadEngine");
+    m_networkThread.start();
+    
+    emit memoryBudgetChanged(qint64(m_settings.value("memory_budget_mb", 64).toInt()) * 1024 * 1024);
+    emit verifyRateLimitChanged(qint64(m_settings.value("verify_rate_kbps", 1024).toInt()) * 1024);
+    emit keyRateLimitChanged(m_settings.value("key_rate_per_minute", 0).toInt());
+    emit mirrorsChanged(m_settings.value("mirror_destinations").toStringList());
+}
+
+void MainWindow::setupUploadQueue()
+{
+    // Jobs are journaled before they run so nothing queued is lost if the
+    // network is down or the application exits; held until the key is valid
+    const QString journalPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                                + "/upload-journal.jsonl";
+    m_uploadQueue = new UploadQueue(journalPath, this);
+    
+    connect(m_uploadQueue, &UploadQueue::jobReady, this, &MainWindow::dispatchUpload);
+    connect(m_uploadQueue, &UploadQueue::jobAbandoned, this, &MainWindow::uploadAbandoned);
+    connect(m_uploadQueue, &UploadQueue::stateChanged, this, &MainWindow::updateQueueState);
+    connect(m_uploadQueue, &UploadQueue::onlineChanged, this, [this](bool online) {
+        if (online) revalidateApiKey();
+    });
+    
+    m_uploadQueue->restore();
+}
+
 void MainWindow::setupUi()
 {
     auto* centralWidget = new QWidget(this);
@@ -68,6 +158,13 @@ void MainWindow::setupUi()
     m_clearHistoryAction = fileMenu->addAction("Clear Upload History");
     connect(m_clearHistoryAction, &QAction::triggered, this, &MainWindow::clearHistory);
     
+    m_deleteSelectedAction = fileMenu->addAction("Delete Selected Uploads");
+    m_deleteSelectedAction->setShortcut(QKeySequence::Delete);
+    connect(m_deleteSelectedAction, &QAction::triggered, this, &MainWindow::deleteSelectedUploads);
+    
+    m_verifySelectedAction = fileMenu->addAction("Verify Selected Uploads");
+    connect(m_verifySelectedAction, &QAction::triggered, this, &MainWindow::verifySelectedUploads);
+    
     // Add actions to settings menu
     m_autoCopyAction = settingsMenu->addAction("Auto-Copy URL on Upload");
     m_autoCopyAction->setCheckable(true);
@@ -76,8 +173,63 @@ void MainWindow::setupUi()
         m_settings.setValue("auto_copy", checked);
     });
     
+    m_archiveAction = settingsMenu->addAction("Bundle Multiple Files Into One Archive");
+    m_archiveAction->setCheckable(true);
+    m_archiveAction->setChecked(m_settings.value("archive_uploads", false).toBool());
+    connect(m_archiveAction, &QAction::triggered, [this](bool checked) {
+        m_settings.setValue("archive_uploads", checked);
+    });
+    
+    // Verification re-downloads each upload, throttled to verify_rate_kbps
+    m_verifyAction = settingsMenu->addAction("Verify Uploads After Upload");
+    m_verifyAction->setCheckable(true);
+    m_verifyAction->setChecked(m_settings.value("verify_uploads", false).toBool());
+    connect(m_verifyAction, &QAction::triggered, [this](bool checked) {
+        m_settings.setValue("verify_uploads", checked);
+    });
+    
+    // Client-side encryption; per-file keys are kept in the encryption keyring
+    m_encryptAction = settingsMenu->addAction("Encrypt Uploads");
+    m_encryptAction->setCheckable(true);
+    m_encryptAction->setEnabled(EncryptingDevice::isAvailable());
+    m_encryptAction->setChecked(EncryptingDevice::isAvailable() &&
+                                m_settings.value("encrypt_uploads", false).toBool());
+    connect(m_encryptAction, &QAction::triggered, [this](bool checked) {
+        m_settings.setValue("encrypt_uploads", checked);
+    });
+    
+    m_cipherAction = settingsMenu->addAction("Encryption Cipher...");
+    m_cipherAction->setEnabled(EncryptingDevice::isAvailable());
+    connect(m_cipherAction, &QAction::triggered, this, &MainWindow::configureEncryptionCipher);
+    
+    m_memoryBudgetAction = settingsMenu->addAction("Upload Memory Budget...");
+    connect(m_memoryBudgetAction, &QAction::triggered, this, &MainWindow::configureMemoryBudget);
+    
+    m_autoDeleteAction = settingsMenu->addAction("Auto-Delete Old Uploads...");
+    connect(m_autoDeleteAction, &QAction::triggered, this, &MainWindow::configureAutoDelete);
+    
+    settingsMenu->addSeparator();
+    m_extraKeysAction = settingsMenu->addAction("Additional API Keys...");
+    connect(m_extraKeysAction, &QAction::triggered, this, &MainWindow::configureExtraApiKeys);
+    
+    m_keyRateAction = settingsMenu->addAction("Uploads Per Key Per Minute...");
+    connect(m_keyRateAction, &QAction::triggered, this, &MainWindow::configureKeyRateLimit);
+    
+    m_mirrorsAction = settingsMenu->addAction("Mirror Destinations...");
+    connect(m_mirrorsAction, &QAction::triggered, this, &MainWindow::configureMirrors);
+    
     setMenuBar(menuBar);
     
+    // Upload engine buffer usage, updated by the engine
+    m_memoryLabel = new QLabel(this);
+    m_memoryLabel->setObjectName("memoryLabel");
+    statusBar()->addPermanentWidget(m_memoryLabel);
+    
+    // Offline / queued upload indicator, updated by the upload queue
+    m_queueLabel = new QLabel(this);
+    m_queueLabel->setObjectName("queueLabel");
+    statusBar()->addPermanentWidget(m_queueLabel);
+    
     // Create header
     auto* headerWidget = new QWidget(this);
     auto* headerLayout = new QHBoxLayout(headerWidget);
@@ -159,6 +311,10 @@ void MainWindow::setupUi()
     m_historyList = new QListWidget(this);
     m_historyList->setMaximumHeight(150);
     m_historyList->setHidden(true);
+    m_historyList->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_historyList->setContextMenuPolicy(Qt::ActionsContextMenu);
+    m_historyList->addAction(m_deleteSelectedAction);
+    m_historyList->addAction(m_verifySelectedAction);
     mainLayout->addWidget(m_historyList);
     
     connect(m_historyList, &QListWidget::itemDoubleClicked, this, &MainWindow::onHistoryItemDoubleClicked);
@@ -229,7 +385,7 @@ void MainWindow::setupPreviewPanel()
     // Connect button signals
     connect(m_copyUrlButton, &QPushButton::clicked, this, &MainWindow::copyUrl);
     connect(m_openImageButton, &QPushButton::clicked, this, &MainWindow::openImageUrl);
-    connect(m_deleteButton, &QPushButton::clicked, this, &MainWindow::openDeleteUrl);
+    connect(m_deleteButton, &QPushButton::clicked, this, &MainWindow::deleteCurrentUpload);
     
     // Initially hide the panel
     m_previewPanel->hide();
@@ -251,27 +407,159 @@ void MainWindow::openImageUrl()
     }
 }
 
-void MainWindow::openDeleteUrl()
+void MainWindow::deleteCurrentUpload()
 {
-    if (!m_currentDeleteUrl.isEmpty()) {
-        QDesktopServices::openUrl(QUrl(m_currentDeleteUrl));
+    if (m_currentDeleteUrl.isEmpty()) return;
+    
+    QMessageBox::StandardButton reply = QMessageBox::question(
+        this, "Confirm Delete",
+        "Are you sure you want to delete this upload from the server?",
+        QMessageBox::Yes | QMessageBox::No
+    );
+    
+    if (reply == QMessageBox::Yes) {
+        requestDeletes({m_currentDeleteUrl}, true);
     }
 }
 
-void MainWindow::updatePreviewPanel(const QString& imageUrl, const QString& rawUrl, const QString& deleteUrl)
+void MainWindow::deleteSelectedUploads()
+{
+    QStringList deleteUrls;
+    const QList<QListWidgetItem*> selected = m_historyList->selectedItems();
+    for (QListWidgetItem* item : selected) {
+        QStringList urls = item->data(Qt::UserRole).toStringList();
+        if (urls.size() == 3 && !urls[2].isEmpty()) {
+            deleteUrls.append(urls[2]);
+        }
+    }
+    if (deleteUrls.isEmpty()) return;
+    
+    QMessageBox::StandardButton reply = QMessageBox::question(
+        this, "Confirm Delete",
+        QString("Are you sure you want to delete %1 upload(s) from the server?").arg(deleteUrls.size()),
+        QMessageBox::Yes | QMessageBox::No
+    );
+    
+    if (reply == QMessageBox::Yes) {
+        requestDeletes(deleteUrls, true);
+    }
+}
+
+void MainWindow::requestDeletes(const QStringList& deleteUrls, bool userInitiated)
+{
+    QStringList toDelete;
+    for (const QString& deleteUrl : deleteUrls) {
+        if (m_deletesInFlight.contains(deleteUrl)) continue;
+        m_deletesInFlight.insert(deleteUrl);
+        if (userInitiated) {
+            m_userDeletes.insert(deleteUrl);
+        }
+        toDelete.append(deleteUrl);
+    }
+    if (toDelete.isEmpty()) return;
+    
+    statusBar()->showMessage(QString("Deleting %1 upload(s)...").arg(m_deletesInFlight.size()));
+    emit deleteRequested(toDelete);
+}
+
+void MainWindow::uploadDeleted(const QString& deleteUrl, bool success, const QString& message)
+{
+    m_deletesInFlight.remove(deleteUrl);
+    const bool userInitiated = m_userDeletes.remove(deleteUrl);
+    
+    if (success) {
+        ++m_deletedCount;
+        removeFromHistory(deleteUrl);
+        if (deleteUrl == m_currentDeleteUrl) {
+            clearPreviewPanel();
+        }
+    } else if (userInitiated) {
+        m_deleteFailures.append(message);
+    }
+    
+    if (!m_deletesInFlight.isEmpty()) {
+        statusBar()->showMessage(QString("Deleting %1 upload(s)...").arg(m_deletesInFlight.size()));
+        return;
+    }
+    
+    // Batch complete; report once rather than per file
+    if (m_expiryQueueDirty) {
+        saveExpiryQueue();
+    }
+    if (m_encryptionKeysDirty) {
+        saveEncryptionKeys();
+    }
+    statusBar()->showMessage(QString("Deleted %1 upload(s)").arg(m_deletedCount), 3000);
+    if (!m_deleteFailures.isEmpty()) {
+        QMessageBox::warning(this, "Delete Error",
+                             QString("Failed to delete %1 upload(s): %2")
+                             .arg(m_deleteFailures.size()).arg(m_deleteFailures.first()));
+    }
+    m_deletedCount = 0;
+    m_deleteFailures.clear();
+}
+
+void MainWindow::configureAutoDelete()
+{
+    bool ok = false;
+    int days = QInputDialog::getInt(this, "Auto-Delete Old Uploads",
+                                    "Delete uploads from the server after this many days (0 = never):",
+                                    m_settings.value("auto_delete_days", 0).toInt(),
+                                    0, 3650, 1, &ok);
+    if (!ok) return;
+    
+    m_settings.setValue("auto_delete_days", days);
+    expireOldUploads();
+}
+
+void MainWindow::configureMemoryBudget()
+{
+    bool ok = false;
+    int megabytes = QInputDialog::getInt(this, "Upload Memory Budget",
+                                         "Maximum memory for upload buffers (MB):",
+                                         m_settings.value("memory_budget_mb", 64).toInt(),
+                                         1, 65536, 16, &ok);
+    if (!ok) return;
+    
+    m_settings.setValue("memory_budget_mb", megabytes);
+    emit memoryBudgetChanged(qint64(megabytes) * 1024 * 1024);
+}
+
+void MainWindow::updateMemoryUsage(qint64 bytesInUse, qint64 peakBytes, qint64 budgetBytes)
+{
+    m_memoryLabel->setText(QString("Buffers: %1 / %2 MB")
+                           .arg(bytesInUse / 1024.0 / 1024.0, 0, 'f', 1)
+                           .arg(budgetBytes / 1024.0 / 1024.0, 0, 'f', 0));
+    m_memoryLabel->setToolTip(QString("Peak: %1 MB").arg(peakBytes / 1024.0 / 1024.0, 0, 'f', 1));
+}
+
+void MainWindow::expireOldUploads()
+{
+    const int days = m_settings.value("auto_delete_days", 0).toInt();
+    if (days <= 0) return;
+    
+    const QDateTime cutoff = QDateTime::currentDateTimeUtc().addDays(-days);
+    QStringList expired;
+    for (auto it = m_expiryQueue.cbegin(); it != m_expiryQueue.cend(); ++it) {
+        if (it.value().isValid() && it.value() < cutoff) {
+            expired.append(it.key());
+        }
+    }
+    
+    // Failures stay queued and are retried on the next sweep
+    requestDeletes(expired, false);
+}
+
+void MainWindow::updatePreviewPanel(const QJsonObject& entry)
 {
     // Store URLs
-    m_currentImageUrl = imageUrl;
-    m_currentRawUrl = rawUrl;
-    m_currentDeleteUrl = deleteUrl;
-
-    // Update file info from the current upload
-    if (m_currentUpload) {
-        QString filePath = m_currentUpload->property("filePath").toString();
-        QFileInfo fileInfo(filePath);
-        m_fileNameLabel->setText(fileInfo.fileName());
-        QString size = QString::number(fileInfo.size() / 1024.0 / 1024.0, 'f', 2) + " MB";
-        m_fileSizeLabel->setText(size);
+    m_currentImageUrl = entry["image"].toString();
+    m_currentRawUrl = entry["raw"].toString();
+    m_currentDeleteUrl = entry["delete"].toString();
+    m_currentEncryptionKey = encryptionKey(m_currentRawUrl);
+    if (m_currentEncryptionKey.isEmpty()) {
+        // Entries from before the keyring carried the key themselves
+        m_currentEncryptionKey = QByteArray::fromBase64(entry["encryption"].toObject()["key"].toString().toLatin1());
     }
 
     // Show preview panel
@@ -282,7 +570,10 @@ void MainWindow::updatePreviewPanel(const QString& imageUrl, const QString& rawU
     m_openImageButton->setEnabled(true);
     m_deleteButton->setEnabled(true);
 
-    // If it's an image URL, download and show preview
+    // If it's an image URL, download and show preview. The server cannot
+    // tell what an encrypted upload is, so go by the original file name.
+    const QString imageUrl = m_currentEncryptionKey.isEmpty() ? m_currentImageUrl
+                                                              : entry["name"].toString().toLower();
     if (imageUrl.contains(".png") || imageUrl.contains(".jpg") || 
         imageUrl.contains(".jpeg") || imageUrl.contains(".gif") ||
         imageUrl.contains(".webp")) {
@@ -296,106 +587,254 @@ void MainWindow::updatePreviewPanel(const QString& imageUrl, const QString& rawU
 
 void MainWindow::downloadPreviewImage()
 {
-    if (m_currentImageUrl.isEmpty()) return;
+    // Encrypted uploads are fetched as raw bytes and decrypted by the engine
+    m_previewUrl = m_currentEncryptionKey.isEmpty() ? m_currentImageUrl : m_currentRawUrl;
+    if (m_previewUrl.isEmpty()) return;
     
-    QNetworkRequest request;
-    request.setUrl(QUrl(m_currentImageUrl));
-    QNetworkReply* reply = m_networkManager.get(request);
+    emit previewRequested(QUrl(m_previewUrl), m_previewImage->size(), m_currentEncryptionKey);
+}
+
+void MainWindow::previewImageDownloaded(const QUrl& url, const QImage& image)
+{
+    // Ignore previews that finished after the user moved on to another entry
+    if (url != QUrl(m_previewUrl)) return;
     
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        reply->deleteLater();
-        
-        if (reply->error() == QNetworkReply::NoError) {
-            QByteArray data = reply->readAll();
-            QPixmap pixmap;
-            if (pixmap.loadFromData(data)) {
-                // Scale pixmap to fit the label while maintaining aspect ratio
-                pixmap = pixmap.scaled(m_previewImage->size(), 
-                                     Qt::KeepAspectRatio, 
-                                     Qt::SmoothTransformation);
-                m_previewImage->setPixmap(pixmap);
-            }
-        } else {
-            // Show error icon if preview fails
-            QPixmap errorIcon = QIcon::fromTheme("dialog-error").pixmap(64, 64);
-            m_previewImage->setPixmap(errorIcon);
-        }
-    });
+    m_previewImage->setPixmap(QPixmap::fromImage(image));
 }
 
-QString MainWindow::getMimeType(const QString& filePath)
+void MainWindow::previewImageFailed(const QUrl& url)
 {
-    QString extension = QFileInfo(filePath).suffix().toLower();
+    if (url != QUrl(m_previewUrl)) return;
     
-    // Image types
-    if (extension == "jpg" || extension == "jpeg") return "image/jpeg";
-    if (extension == "png") return "image/png";
-    if (extension == "gif") return "image/gif";
-    if (extension == "webp") return "image/webp";
-    if (extension == "bmp") return "image/bmp";
+    // Show error icon if preview fails
+    QPixmap errorIcon = QIcon::fromTheme("dialog-error").pixmap(64, 64);
+    m_previewImage->setPixmap(errorIcon);
+}
+
+void MainWindow::validateApiKey(const QString& key)
+{
+    emit validateApiKeyRequested(key);
+}
+
+void MainWindow::validateApiKeyResponse(const QString& key, bool isValid, const QString& message)
+{
+    if (m_pendingKeyValidations.remove(key)) {
+        extraApiKeyValidated(key, isValid, message);
+        return;
+    }
     
-    // Video types
-    if (extension == "mp4") return "video/mp4";
-    if (extension == "webm") return "video/webm";
-    if (extension == "avi") return "video/x-msvideo";
+    // A late answer for a key that has since been replaced or logged out
+    const bool revalidation = m_apiKeyUnverified;
+    if (revalidation && key != m_apiKey) return;
+    m_apiKeyUnverified = false;
+    m_revalidateTimer.stop();
     
-    // Audio types
-    if (extension == "mp3") return "audio/mpeg";
-    if (extension == "wav") return "audio/wav";
-    if (extension == "ogg") return "audio/ogg";
+    if (isValid) {
+        m_apiKey = key;
+        m_settings.setValue("api_key", m_apiKey);
+        m_apiKeyInput->clear();
+        publishApiKeys();
+        updateUiForValidation(true, revalidation ? QString() : "API Key validated successfully!");
+        if (revalidation) {
+            statusBar()->showMessage("Back online, API key verified", 3000);
+        }
+        m_dropArea->setEnabled(true);
+        m_uploadQueue->setPaused(false);
+        expireOldUploads();
+    } else {
+        m_apiKey.clear();
+        m_settings.remove("api_key");
+        publishApiKeys();
+        m_uploadQueue->setPaused(true);
+        updateUiForValidation(false, message);
+        m_dropArea->setEnabled(false);
+    }
+}
+
+void MainWindow::apiKeyUnverified(const QString& key, const QString& message)
+{
+    if (m_pendingKeyValidations.remove(key)) {
+        extraApiKeyValidated(key, false, message);
+        return;
+    }
     
-    // Document types
-    if (extension == "pdf") return "application/pdf";
-    if (extension == "txt") return "text/plain";
+    // A newly entered key is only stored once the server has accepted it
+    if (key != m_settings.value("api_key").toString()) {
+        QMessageBox::warning(this, "Validation Error", message);
+        return;
+    }
     
-    // Default
-    return "application/octet-stream";
+    // Keep the stored key and keep accepting uploads; they wait in the
+    // queue (paused) until the key has been checked against the server
+    m_apiKey = key;
+    m_apiKeyUnverified = true;
+    publishApiKeys();
+    m_uploadQueue->setPaused(true);
+    updateUiForValidation(true);
+    m_statusLabel->setText("… API Key Not Verified (offline)");
+    m_statusLabel->setStyleSheet("color: #ffaa00;");
+    m_dropArea->setEnabled(true);
+    statusBar()->showMessage(message, 5000);
+    if (!m_revalidateTimer.isActive()) {
+        m_revalidateTimer.start();
+    }
 }
 
-void MainWindow::validateApiKey(const QString& key)
+void MainWindow::revalidateApiKey()
 {
-    QUrl url(QString("https://api.e-z.gg/paste/config"));
-    QUrlQuery query;
-    query.addQueryItem("key", key);
-    url.setQuery(query);
+    if (m_apiKeyUnverified && !m_apiKey.isEmpty()) {
+        validateApiKey(m_apiKey);
+    }
+}
+
+void MainWindow::publishApiKeys()
+{
+    // Extra keys only add capacity to an account that is signed in
+    QStringList keys;
+    if (!m_apiKey.isEmpty()) {
+        keys << m_apiKey << m_extraApiKeys;
+    }
+    emit apiKeysChanged(keys);
     
-    QNetworkRequest request(url);
-    QNetworkReply* reply = m_networkManager.get(request);
+    // Let the queue keep every key busy
+    m_uploadQueue->setMaxConcurrentJobs(UploadsPerKey * qMax(int(keys.size()), 1));
+}
+
+void MainWindow::configureExtraApiKeys()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getMultiLineText(this, "Additional API Keys",
+                                                        "Uploads are spread across your API key and these keys (one per line):",
+                                                        m_extraApiKeys.join('\n'), &ok);
+    if (!ok) return;
+    
+    QStringList keys;
+    for (const QString& line : text.split('\n')) {
+        const QString key = line.trimmed();
+        if (!key.isEmpty() && key != m_apiKey && !keys.contains(key)) {
+            keys.append(key);
+        }
+    }
     
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        validateApiKeyResponse(reply);
-    });
+    // Removed keys leave rotation at once; new ones join once validated
+    QStringList kept;
+    for (const QString& key : std::as_const(m_extraApiKeys)) {
+        if (keys.contains(key)) kept.append(key);
+    }
+    m_extraApiKeys = kept;
+    m_settings.setValue("extra_api_keys", m_extraApiKeys);
+    publishApiKeys();
+    
+    m_rejectedExtraKeys.clear();
+    for (const QString& key : std::as_const(keys)) {
+        if (!m_extraApiKeys.contains(key) && !m_pendingKeyValidations.contains(key)) {
+            m_pendingKeyValidations.insert(key);
+            validateApiKey(key);
+        }
+    }
+}
+
+void MainWindow::extraApiKeyValidated(const QString& key, bool isValid, const QString& message)
+{
+    Q_UNUSED(message);
+    
+    if (isValid) {
+        m_extraApiKeys.append(key);
+        m_settings.setValue("extra_api_keys", m_extraApiKeys);
+        publishApiKeys();
+        statusBar()->showMessage(QString("Uploading with %1 API keys").arg(m_extraApiKeys.size() + 1), 3000);
+    } else {
+        m_rejectedExtraKeys.append("..." + key.right(4));
+    }
+    
+    // Report rejected keys once the whole batch has been checked
+    if (m_pendingKeyValidations.isEmpty() && !m_rejectedExtraKeys.isEmpty()) {
+        QMessageBox::warning(this, "Validation Error",
+                             "These API keys could not be validated and were not added:\n" +
+                             m_rejectedExtraKeys.join('\n'));
+        m_rejectedExtraKeys.clear();
+    }
 }
 
-void MainWindow::validateApiKeyResponse(QNetworkReply* reply)
+void MainWindow::apiKeyRejected(const QString& key, int remainingKeys)
 {
-    reply->deleteLater();
+    if (remainingKeys > 0) {
+        statusBar()->showMessage("API key ending in " + key.right(4) +
+                                 " was refused by the server and is no longer used", 5000);
+        return;
+    }
     
-    if (reply->error() == QNetworkReply::NoError) {
-        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-        if (statusCode == 200) {
-            // Only update the stored key if we're validating a new key
-            if (!m_apiKeyInput->text().isEmpty()) {
-                m_apiKey = m_apiKeyInput->text().trimmed();
-                m_settings.setValue("api_key", m_apiKey);
-                m_apiKeyInput->clear();
+    // Nothing left to upload with; hold the queue until a key is re-entered
+    m_uploadQueue->setPaused(true);
+    updateUiForValidation(false, "The server refused your API key. Please enter it again to resume uploading.");
+}
+
+void MainWindow::configureKeyRateLimit()
+{
+    bool ok = false;
+    int perMinute = QInputDialog::getInt(this, "Uploads Per Key Per Minute",
+                                         "Maximum uploads started per API key each minute (0 = no limit):",
+                                         m_settings.value("key_rate_per_minute", 0).toInt(),
+                                         0, 10000, 1, &ok);
+    if (!ok) return;
+    
+    m_settings.setValue("key_rate_per_minute", perMinute);
+    emit keyRateLimitChanged(perMinute);
+}
+
+void MainWindow::configureMirrors()
+{
+    QString text = m_settings.value("mirror_destinations").toStringList().join('\n');
+    
+    // Re-prompt with the user's text until every line parses
+    while (true) {
+        bool ok = false;
+        text = QInputDialog::getMultiLineText(this, "Mirror Destinations",
+                                              "Every upload is also copied to these destinations, one per line:\n"
+                                              "  webdav https://host/path [user:password]\n"
+                                              "  s3 https://host/bucket accessKey:secretKey [region]",
+                                              text, &ok);
+        if (!ok) return;
+        
+        QStringList specs;
+        QStringList errors;
+        for (const QString& line : text.split('\n')) {
+            const QString spec = line.trimmed();
+            if (spec.isEmpty() || spec.startsWith('#')) continue;
+            
+            QString error;
+            if (MirrorDestination::parse(spec, &error).isValid()) {
+                specs.append(spec);
+            } else {
+                errors.append(spec.section(' ', 0, 1) + ": " + error);
             }
-            updateUiForValidation(true, "API Key validated successfully!");
-            m_dropArea->setEnabled(true);
-        } else {
-            m_apiKey.clear();
-            m_settings.remove("api_key");
-            updateUiForValidation(false, "Invalid API Key");
-            m_dropArea->setEnabled(false);
         }
-    } else {
-        m_apiKey.clear();
-        m_settings.remove("api_key");
-        updateUiForValidation(false, "Failed to validate API Key: " + reply->errorString());
-        m_dropArea->setEnabled(false);
+        
+        if (!errors.isEmpty()) {
+            QMessageBox::warning(this, "Invalid Mirror", errors.join('\n'));
+            continue;
+        }
+        
+        m_settings.setValue("mirror_destinations", specs);
+        emit mirrorsChanged(specs);
+        return;
     }
 }
 
+void MainWindow::configureEncryptionCipher()
+{
+    const QStringList ciphers = EncryptingDevice::ciphers();
+    const int current = qMax(int(ciphers.indexOf(m_settings.value("encryption_cipher", ciphers.first()).toString())), 0);
+    
+    bool ok = false;
+    const QString cipher = QInputDialog::getItem(this, "Encryption Cipher",
+                                                 "Cipher for encrypted uploads:",
+                                                 ciphers, current, false, &ok);
+    if (!ok) return;
+    
+    m_settings.setValue("encryption_cipher", cipher);
+}
+
 void MainWindow::updateUiForValidation(bool isValid, const QString& message)
 {
     if (isValid) {
@@ -430,6 +869,10 @@ void MainWindow::logout()
     if (reply == QMessageBox::Yes) {
         m_settings.remove("api_key");
         m_apiKey.clear();
+        m_apiKeyUnverified = false;
+        m_revalidateTimer.stop();
+        publishApiKeys();
+        m_uploadQueue->setPaused(true);
         updateUiForValidation(false);
     }
 }
@@ -496,18 +939,12 @@ void MainWindow::dropEvent(QDropEvent* event)
     const QList<QUrl> urls = event->mimeData()->urls();
     if (urls.isEmpty()) return;
     
-    QString filePath = urls.first().toLocalFile();
-    if (!isValidFileType(filePath)) {
-        QMessageBox::warning(this, "Invalid File", "Please select a valid file type (image/video/audio/application).");
-        return;
-    }
-    
-    if (!isFileSizeValid(filePath)) {
-        QMessageBox::warning(this, "Invalid File Size", "File size must be less than 100MB.");
-        return;
+    QStringList filePaths;
+    for (const QUrl& url : urls) {
+        filePaths.append(url.toLocalFile());
     }
     
-    uploadFile(filePath);
+    uploadFiles(filePaths);
     event->acceptProposedAction();
 }
 
@@ -518,22 +955,42 @@ void MainWindow::handleFileSelection()
         return;
     }
     
-    QString filePath = QFileDialog::getOpenFileName(this, "Select File",
-                                                  QDir::homePath(),  // Start in home directory
-                                                  "All Files (*.*)");
-    if (filePath.isEmpty()) return;
+    QStringList filePaths = QFileDialog::getOpenFileNames(this, "Select Files",
+                                                        QDir::homePath(),  // Start in home directory
+                                                        "All Files (*.*)");
+    if (filePaths.isEmpty()) return;
     
-    if (!isValidFileType(filePath)) {
-        QMessageBox::warning(this, "Invalid File", "Please select a valid file type (image/video/audio/application).");
-        return;
+    uploadFiles(filePaths);
+}
+
+void MainWindow::uploadFiles(const QStringList& filePaths)
+{
+    // Several files, or any directory, go up as a single archive when enabled
+    if (m_archiveAction->isChecked()) {
+        bool hasDirectory = std::any_of(filePaths.cbegin(), filePaths.cend(), [](const QString& path) {
+            return QFileInfo(path).isDir();
+        });
+        if (filePaths.size() > 1 || hasDirectory) {
+            uploadArchive(filePaths);
+            return;
+        }
     }
     
-    if (!isFileSizeValid(filePath)) {
-        QMessageBox::warning(this, "Invalid File Size", "File size must be less than 100MB.");
-        return;
+    // Queue every acceptable file; the engine runs them concurrently
+    QStringList rejected;
+    for (const QString& filePath : filePaths) {
+        if (!isValidFileType(filePath) || !isFileSizeValid(filePath)) {
+            rejected.append(QFileInfo(filePath).fileName());
+            continue;
+        }
+        uploadFile(filePath);
     }
     
-    uploadFile(filePath);
+    if (!rejected.isEmpty()) {
+        QMessageBox::warning(this, "Invalid File",
+                             "The following files were skipped. Files must be image/video/audio/application "
+                             "types and less than 100MB:\n" + rejected.join("\n"));
+    }
 }
 
 bool MainWindow::isValidFileType(const QString& filePath)
@@ -572,113 +1029,226 @@ void MainWindow::uploadFile(const QString& filePath)
         return;
     }
     
-    QFile* file = new QFile(filePath);
-    if (!file->open(QIODevice::ReadOnly)) {
-        QMessageBox::warning(this, "Error", "Failed to open file: " + file->errorString());
-        file->deleteLater();
+    m_uploadQueue->enqueue("file", {filePath}, QFileInfo(filePath).fileName());
+}
+
+void MainWindow::uploadArchive(const QStringList& sourcePaths)
+{
+    if (m_apiKey.isEmpty()) {
+        QMessageBox::warning(this, "Error", "Please enter a valid API key first.");
+        updateUiForValidation(false);
         return;
     }
     
-    QHttpMultiPart* multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
-    
-    // Add file part with proper MIME type
-    QHttpPart filePart;
-    QString mimeType = getMimeType(filePath);
-    filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant(mimeType));
+    const QString archiveName = QString("upload-%1.%2")
+        .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"), ArchiveStream::fileExtension());
     
-    filePart.setHeader(QNetworkRequest::ContentDispositionHeader, 
-                      QVariant(QString("form-data; name=\"file\"; filename=\"%1\"")
-                              .arg(QFileInfo(filePath).fileName())));
-    filePart.setBodyDevice(file);
-    multiPart->append(filePart);
-    
-    // Create and send request
-    QUrl url("https://api.e-z.host/files");
-    QNetworkRequest request(url);
-    request.setHeader(QNetworkRequest::ContentTypeHeader,
-                     QString("multipart/form-data; boundary=%1").arg(multiPart->boundary().data()));
-    request.setRawHeader("key", m_apiKey.toUtf8());
-    
-    m_currentUpload = m_networkManager.post(request, multiPart);
-    m_currentUpload->setProperty("filePath", filePath);
-    multiPart->setParent(m_currentUpload);
-    file->setParent(m_currentUpload);
+    m_uploadQueue->enqueue("archive", sourcePaths, archiveName);
+}
+
+void MainWindow::dispatchUpload(quint64 jobId, const QString& kind, const QStringList& paths, const QString& name)
+{
+    // A fresh key per attempt, so keys never need to go into the journal
+    QString cipher;
+    QByteArray key;
+    if (m_encryptAction->isChecked()) {
+        cipher = m_settings.value("encryption_cipher", EncryptingDevice::ciphers().first()).toString();
+        key = EncryptingDevice::generateKey();
+        m_jobEncryption.insert(jobId, qMakePair(cipher, key));
+    }
     
-    connect(m_currentUpload, &QNetworkReply::uploadProgress,
-            this, &MainWindow::uploadProgress);
-    connect(m_currentUpload, &QNetworkReply::finished,
-            this, &MainWindow::uploadFinished);
+    if (kind == "archive") {
+        // The engine enumerates directories and reports members via archiveReady
+        m_activeUploads.insert(jobId, qMakePair(qint64(0), qint64(0)));
+        m_archiveMembers.insert(jobId, QStringList());
+        emit archiveUploadRequested(jobId, name, paths, cipher, key);
+        statusBar()->showMessage("Building archive...");
+    } else {
+        const QString filePath = paths.value(0);
+        m_activeUploads.insert(jobId, qMakePair(qint64(0), QFileInfo(filePath).size()));
+        emit uploadRequested(jobId, filePath, cipher, key);
+    }
     
-    m_progressBar->setValue(0);
+    updateAggregateProgress();
     m_progressBar->show();
-    m_dropArea->setEnabled(false);
 }
 
-void MainWindow::uploadProgress(qint64 bytesSent, qint64 bytesTotal)
+void MainWindow::archiveReady(quint64 jobId, const QStringList& memberNames, qint64 uncompressedSize)
+{
+    if (!m_archiveMembers.contains(jobId)) return;
+    m_archiveMembers[jobId] = memberNames;
+    
+    statusBar()->showMessage(QString("Uploading archive of %1 file(s), %2 MB uncompressed")
+                             .arg(memberNames.size())
+                             .arg(uncompressedSize / 1024.0 / 1024.0, 0, 'f', 2), 3000);
+}
+
+void MainWindow::uploadProgress(quint64 jobId, qint64 bytesSent, qint64 bytesTotal)
 {
+    auto it = m_activeUploads.find(jobId);
+    if (it == m_activeUploads.end()) return;
+    
+    // The multipart body is slightly larger than the file; prefer the real total
+    it->first = bytesSent;
     if (bytesTotal > 0) {
-        int progress = static_cast<int>((bytesSent * 100) / bytesTotal);
-        m_progressBar->setValue(progress);
+        it->second = bytesTotal;
     }
+    updateAggregateProgress();
 }
 
-void MainWindow::uploadFinished()
+void MainWindow::updateAggregateProgress()
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
+    qint64 sent = 0;
+    qint64 total = 0;
+    for (const auto& progress : std::as_const(m_activeUploads)) {
+        sent += progress.first;
+        total += progress.second;
+    }
     
-    m_progressBar->hide();
-    m_dropArea->setEnabled(true);
+    if (total > 0) {
+        m_progressBar->setValue(static_cast<int>((sent * 100) / total));
+    } else {
+        m_progressBar->setValue(0);
+    }
     
-    if (reply->error() == QNetworkReply::NoError) {
-        QByteArray response = reply->readAll();
-        showUploadResult(response);
-        
-        // Auto-copy URL if enabled
-        if (m_autoCopyAction && m_autoCopyAction->isChecked()) {
-            QClipboard* clipboard = QGuiApplication::clipboard();
-            clipboard->setText(m_currentImageUrl);
-            statusBar()->showMessage("URL copied to clipboard!", 3000);
-        }
+    if (m_activeUploads.size() > 1) {
+        m_progressBar->setFormat(QString("%p% (%1 uploads)").arg(m_activeUploads.size()));
     } else {
-        QString errorMsg = reply->errorString();
-        if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
-            int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-            errorMsg = QString("Server returned error %1: %2").arg(statusCode).arg(errorMsg);
+        m_progressBar->setFormat("%p%");
+    }
+}
+
+void MainWindow::uploadSucceeded(quint64 jobId, const QString& filePath, const QString& imageUrl,
+                                 const QString& rawUrl, const QString& deleteUrl, const QByteArray& sha256,
+                                 const QJsonObject& mirrors)
+{
+    m_activeUploads.remove(jobId);
+    if (m_activeUploads.isEmpty()) {
+        m_progressBar->hide();
+    } else {
+        updateAggregateProgress();
+    }
+    
+    QJsonObject entry;
+    entry["name"] = QFileInfo(filePath).fileName();
+    entry["image"] = imageUrl;
+    entry["raw"] = rawUrl;
+    entry["delete"] = deleteUrl;
+    const QStringList members = m_archiveMembers.take(jobId);
+    if (!members.isEmpty()) {
+        entry["members"] = QJsonArray::fromStringList(members);
+    }
+    if (!sha256.isEmpty()) {
+        entry["sha256"] = QString::fromLatin1(sha256);
+    }
+    if (!mirrors.isEmpty()) {
+        entry["mirrors"] = mirrors;
+    }
+    if (m_jobEncryption.contains(jobId)) {
+        const auto [cipher, key] = m_jobEncryption.take(jobId);
+        storeEncryptionKey(rawUrl, deleteUrl, key);
+        QJsonObject encryption;
+        encryption["cipher"] = cipher;
+        entry["encryption"] = encryption;
+    }
+    showUploadResult(filePath, entry);
+    m_uploadQueue->markFinished(jobId);
+    reportAbandonedUploads();
+    
+    if (m_verifyAction->isChecked() && !sha256.isEmpty()) {
+        requestVerification(rawUrl, sha256);
+    }
+    
+    QStringList failedMirrors;
+    for (auto it = mirrors.begin(); it != mirrors.end(); ++it) {
+        if (it.value().toObject().contains("error")) {
+            failedMirrors.append(it.key());
         }
-        QMessageBox::critical(this, "Upload Error", 
-                            "Failed to upload file: " + errorMsg + 
-                            "\nPlease check your internet connection and API key.");
+    }
+    if (!failedMirrors.isEmpty()) {
+        statusBar()->showMessage("Mirror upload failed: " + failedMirrors.join(", "), 5000);
     }
     
-    reply->deleteLater();
+    // Auto-copy URL if enabled
+    if (m_autoCopyAction && m_autoCopyAction->isChecked()) {
+        QClipboard* clipboard = QGuiApplication::clipboard();
+        clipboard->setText(m_currentImageUrl);
+        statusBar()->showMessage("URL copied to clipboard!", 3000);
+    }
 }
 
-void MainWindow::showUploadResult(const QByteArray& response)
+void MainWindow::uploadFailed(quint64 jobId, const QString& filePath, const QString& message, bool retryable)
 {
-    QJsonDocument doc = QJsonDocument::fromJson(response);
-    if (!doc.isObject()) {
-        QMessageBox::warning(this, "Error", "Invalid response from server");
-        return;
+    m_activeUploads.remove(jobId);
+    m_archiveMembers.remove(jobId);
+    m_jobEncryption.remove(jobId);
+    if (m_activeUploads.isEmpty()) {
+        m_progressBar->hide();
+    } else {
+        updateAggregateProgress();
     }
     
-    QJsonObject obj = doc.object();
-    if (!obj["success"].toBool()) {
-        QString message = obj["message"].toString("Unknown error");
-        QMessageBox::warning(this, "Upload Failed", message);
-        return;
+    // Permanent failures are reported through uploadAbandoned
+    if (retryable) {
+        statusBar()->showMessage("Upload of " + QFileInfo(filePath).fileName() +
+                                 " failed, will retry: " + message, 5000);
+    }
+    m_uploadQueue->markFailed(jobId, message, retryable);
+    reportAbandonedUploads();
+}
+
+void MainWindow::uploadAbandoned(quint64 jobId, const QString& name, const QString& message)
+{
+    Q_UNUSED(jobId);
+    m_abandonedUploads.append(name + ": " + message);
+}
+
+void MainWindow::reportAbandonedUploads()
+{
+    // The queue has already started the next jobs by now; wait for the batch
+    if (m_abandonedUploads.isEmpty() || !m_activeUploads.isEmpty()) return;
+    
+    // Batch complete; report once rather than per file
+    const int count = int(m_abandonedUploads.size());
+    QStringList lines = m_abandonedUploads.mid(0, 10);
+    if (count > lines.size()) {
+        lines.append(QString("... and %1 more").arg(count - lines.size()));
     }
+    m_abandonedUploads.clear();
     
-    QJsonObject data = obj["data"].toObject();
-    QString imageUrl = data["url"].toString();
-    QString rawUrl = data["raw"].toString();
-    QString deleteUrl = data["delete"].toString();
+    QMessageBox::critical(this, "Upload Error",
+                          QString("Failed to upload %1 file(s):\n").arg(count) + lines.join('\n') +
+                          "\nPlease check your internet connection and API key.");
+}
+
+void MainWindow::updateQueueState(bool online, int pendingCount)
+{
+    if (!online) {
+        m_queueLabel->setText(QString("Offline - %1 upload(s) queued").arg(pendingCount));
+    } else if (pendingCount > 0) {
+        m_queueLabel->setText(QString("%1 upload(s) queued").arg(pendingCount));
+    } else {
+        m_queueLabel->clear();
+    }
+}
+
+void MainWindow::showUploadResult(const QString& filePath, const QJsonObject& entry)
+{
+    updatePreviewPanel(entry);
     
-    updatePreviewPanel(imageUrl, rawUrl, deleteUrl);
+    // Update file info from the finished upload; archives have no local file
+    QFileInfo fileInfo(filePath);
+    m_fileNameLabel->setText(fileInfo.fileName());
+    const QJsonArray members = entry["members"].toArray();
+    if (members.isEmpty()) {
+        QString size = QString::number(fileInfo.size() / 1024.0 / 1024.0, 'f', 2) + " MB";
+        m_fileSizeLabel->setText(size);
+    } else {
+        m_fileSizeLabel->setText(QString("%1 files").arg(members.size()));
+    }
     
     // Add to history
-    QString fileName = QFileInfo(m_currentUpload->property("filePath").toString()).fileName();
-    addToHistory(fileName, imageUrl, rawUrl, deleteUrl);
+    addToHistory(entry);
     
     statusBar()->showMessage("File uploaded successfully!", 3000);
 }
@@ -688,6 +1258,8 @@ void MainWindow::clearPreviewPanel()
     m_currentImageUrl.clear();
     m_currentRawUrl.clear();
     m_currentDeleteUrl.clear();
+    m_currentEncryptionKey.clear();
+    m_previewUrl.clear();
     m_previewImage->clear();
     m_fileNameLabel->clear();
     m_fileSizeLabel->clear();
@@ -696,15 +1268,12 @@ void MainWindow::clearPreviewPanel()
 
 void MainWindow::loadHistory()
 {
+    // Stored newest first; insert oldest first so the list ends up in order
     QStringList history = m_settings.value("upload_history").toStringList();
-    for (const QString& entry : history) {
-        QJsonDocument doc = QJsonDocument::fromJson(entry.toUtf8());
+    for (auto it = history.crbegin(); it != history.crend(); ++it) {
+        QJsonDocument doc = QJsonDocument::fromJson(it->toUtf8());
         if (doc.isObject()) {
-            QJsonObject obj = doc.object();
-            addToHistory(obj["name"].toString(), 
-                        obj["image"].toString(),
-                        obj["raw"].toString(),
-                        obj["delete"].toString());
+            addHistoryItem(doc.object());
         }
     }
     
@@ -713,24 +1282,84 @@ void MainWindow::loadHistory()
     }
 }
 
-void MainWindow::addToHistory(const QString& fileName, const QString& imageUrl, 
-                            const QString& rawUrl, const QString& deleteUrl)
+void MainWindow::addHistoryItem(const QJsonObject& entry)
 {
     // Create history item
-    auto* item = new QListWidgetItem(fileName);
-    item->setData(Qt::UserRole, QStringList({imageUrl, rawUrl, deleteUrl}));
+    auto* item = new QListWidgetItem(entry["name"].toString());
+    item->setData(Qt::UserRole, QStringList({entry["image"].toString(),
+                                             entry["raw"].toString(),
+                                             entry["delete"].toString()}));
+    updateHistoryItem(item, entry);
     
     // Add to list and show if hidden
     m_historyList->insertItem(0, item);
     m_historyList->setHidden(false);
+}
+
+void MainWindow::updateHistoryItem(QListWidgetItem* item, const QJsonObject& entry)
+{
+    item->setData(HistoryEntryRole, entry);
     
-    // Save to settings
-    QJsonObject entry;
-    entry["name"] = fileName;
-    entry["image"] = imageUrl;
-    entry["raw"] = rawUrl;
-    entry["delete"] = deleteUrl;
+    QStringList tooltip;
+    QDateTime uploaded = QDateTime::fromString(entry["uploaded"].toString(), Qt::ISODate);
+    if (uploaded.isValid()) {
+        tooltip.append("Uploaded " + uploaded.toLocalTime().toString(Qt::TextDate));
+    }
     
+    // Archives list their first few members; the full list stays in settings
+    const QJsonArray members = entry["members"].toArray();
+    if (!members.isEmpty()) {
+        tooltip.append(QString("Archive of %1 files:").arg(members.size()));
+        for (qsizetype i = 0; i < qMin<qsizetype>(members.size(), 10); ++i) {
+            tooltip.append("  " + members[i].toString());
+        }
+        if (members.size() > 10) {
+            tooltip.append("  ...");
+        }
+    }
+    
+    const QJsonObject encryption = entry["encryption"].toObject();
+    if (!encryption.isEmpty()) {
+        tooltip.append("Encrypted (" + encryption["cipher"].toString() + "); the key is kept until the upload is deleted");
+    }
+    
+    // Mirror copies
+    const QJsonObject mirrors = entry["mirrors"].toObject();
+    for (auto it = mirrors.begin(); it != mirrors.end(); ++it) {
+        const QJsonObject result = it.value().toObject();
+        if (result.contains("url")) {
+            tooltip.append("Mirrored to " + result["url"].toString());
+        } else {
+            tooltip.append("Mirror " + it.key() + " failed: " + result["error"].toString());
+        }
+    }
+    
+    // Verification outcome
+    const QString verified = entry["verified"].toString();
+    if (verified == "ok") {
+        item->setIcon(QIcon::fromTheme("emblem-default"));
+        tooltip.append("Integrity verified (SHA-256 " + entry["sha256"].toString().left(16) + "...)");
+    } else if (verified == "mismatch") {
+        item->setIcon(QIcon::fromTheme("dialog-warning"));
+        tooltip.append("Integrity check FAILED: " + entry["verify_message"].toString());
+    } else if (verified == "error") {
+        item->setIcon(QIcon::fromTheme("dialog-question"));
+        tooltip.append("Integrity check could not run: " + entry["verify_message"].toString());
+    } else {
+        item->setIcon(QIcon());
+    }
+    
+    item->setToolTip(tooltip.join("\n"));
+}
+
+void MainWindow::addToHistory(QJsonObject entry)
+{
+    const QString deleteUrl = entry["delete"].toString();
+    entry["uploaded"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    
+    addHistoryItem(entry);
+    
+    // Save to settings
     QStringList history = m_settings.value("upload_history").toStringList();
     history.prepend(QJsonDocument(entry).toJson(QJsonDocument::Compact));
     
@@ -740,10 +1369,236 @@ void MainWindow::addToHistory(const QString& fileName, const QString& imageUrl,
     }
     
     m_settings.setValue("upload_history", history);
+    
+    // The expiry queue is not capped like the visible history, so uploads
+    // that scrolled out of the list are still purged by auto-delete
+    if (!deleteUrl.isEmpty()) {
+        QJsonObject expiry;
+        expiry["delete"] = deleteUrl;
+        expiry["uploaded"] = entry["uploaded"];
+        m_expiryQueue.insert(deleteUrl, QDateTime::fromString(entry["uploaded"].toString(), Qt::ISODate));
+        
+        QFile file(m_expiryQueuePath);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            file.write(QJsonDocument(expiry).toJson(QJsonDocument::Compact) + '\n');
+        }
+    }
+}
+
+void MainWindow::loadExpiryQueue()
+{
+    m_expiryQueuePath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                        + "/expiry-queue.jsonl";
+    QDir().mkpath(QFileInfo(m_expiryQueuePath).absolutePath());
+    
+    auto addEntry = [this](const QByteArray& json) {
+        const QJsonObject obj = QJsonDocument::fromJson(json).object();
+        const QString deleteUrl = obj["delete"].toString();
+        if (!deleteUrl.isEmpty()) {
+            m_expiryQueue.insert(deleteUrl, QDateTime::fromString(obj["uploaded"].toString(), Qt::ISODate));
+        }
+    };
+    
+    QFile file(m_expiryQueuePath);
+    if (file.open(QIODevice::ReadOnly)) {
+        while (!file.atEnd()) {
+            addEntry(file.readLine());
+        }
+    }
+    
+    // Older versions kept the queue in settings; move it over once
+    if (m_settings.contains("expiry_queue")) {
+        for (const QString& entry : m_settings.value("expiry_queue").toStringList()) {
+            addEntry(entry.toUtf8());
+        }
+        saveExpiryQueue();
+        m_settings.remove("expiry_queue");
+    }
+}
+
+void MainWindow::saveExpiryQueue()
+{
+    QSaveFile file(m_expiryQueuePath);
+    if (!file.open(QIODevice::WriteOnly)) return;
+    
+    for (auto it = m_expiryQueue.cbegin(); it != m_expiryQueue.cend(); ++it) {
+        QJsonObject expiry;
+        expiry["delete"] = it.key();
+        expiry["uploaded"] = it.value().toString(Qt::ISODate);
+        file.write(QJsonDocument(expiry).toJson(QJsonDocument::Compact) + '\n');
+    }
+    if (file.commit()) {
+        m_expiryQueueDirty = false;
+    }
+}
+
+void MainWindow::updateHistoryEntry(const QString& rawUrl, const QJsonObject& changes)
+{
+    auto apply = [&changes](QJsonObject entry) {
+        for (auto it = changes.constBegin(); it != changes.constEnd(); ++it) {
+            entry[it.key()] = it.value();
+        }
+        return entry;
+    };
+    
+    for (int i = 0; i < m_historyList->count(); ++i) {
+        QListWidgetItem* item = m_historyList->item(i);
+        QJsonObject entry = item->data(HistoryEntryRole).toJsonObject();
+        if (entry["raw"].toString() == rawUrl) {
+            updateHistoryItem(item, apply(entry));
+        }
+    }
+    
+    QStringList history = m_settings.value("upload_history").toStringList();
+    for (QString& stored : history) {
+        QJsonObject entry = QJsonDocument::fromJson(stored.toUtf8()).object();
+        if (entry["raw"].toString() == rawUrl) {
+            stored = QString::fromUtf8(QJsonDocument(apply(entry)).toJson(QJsonDocument::Compact));
+        }
+    }
+    m_settings.setValue("upload_history", history);
+}
+
+void MainWindow::requestVerification(const QString& rawUrl, const QByteArray& sha256)
+{
+    ++m_verificationsInFlight;
+    statusBar()->showMessage(QString("Verifying %1 upload(s)...").arg(m_verificationsInFlight));
+    emit verifyRequested(rawUrl, sha256);
+}
+
+void MainWindow::verifySelectedUploads()
+{
+    const QList<QListWidgetItem*> selected = m_historyList->selectedItems();
+    for (QListWidgetItem* item : selected) {
+        const QJsonObject entry = item->data(HistoryEntryRole).toJsonObject();
+        requestVerification(entry["raw"].toString(), entry["sha256"].toString().toLatin1());
+    }
+}
+
+void MainWindow::verificationFinished(const QString& rawUrl, const QString& status, const QString& message)
+{
+    m_verificationsInFlight = qMax(0, m_verificationsInFlight - 1);
+    
+    QJsonObject changes;
+    changes["verified"] = status;
+    changes["verify_message"] = message;
+    updateHistoryEntry(rawUrl, changes);
+    
+    if (status == "mismatch") {
+        statusBar()->showMessage("Integrity check failed for " + rawUrl, 10000);
+    } else if (m_verificationsInFlight > 0) {
+        statusBar()->showMessage(QString("Verifying %1 upload(s)...").arg(m_verificationsInFlight));
+    } else {
+        statusBar()->showMessage("Verification complete", 3000);
+    }
+}
+
+void MainWindow::removeFromHistory(const QString& deleteUrl)
+{
+    for (int i = m_historyList->count() - 1; i >= 0; --i) {
+        QStringList urls = m_historyList->item(i)->data(Qt::UserRole).toStringList();
+        if (urls.size() == 3 && urls[2] == deleteUrl) {
+            delete m_historyList->takeItem(i);
+        }
+    }
+    if (!m_historyList->count()) {
+        m_historyList->setHidden(true);
+    }
+    
+    auto removeMatching = [this, &deleteUrl](const QString& key) {
+        QStringList entries = m_settings.value(key).toStringList();
+        const auto removed = entries.removeIf([&deleteUrl](const QString& entry) {
+            return QJsonDocument::fromJson(entry.toUtf8()).object()["delete"].toString() == deleteUrl;
+        });
+        if (removed > 0) {
+            m_settings.setValue(key, entries);
+        }
+    };
+    removeMatching("upload_history");
+    if (m_expiryQueue.remove(deleteUrl) > 0) {
+        m_expiryQueueDirty = true;  // written once the delete batch is done
+    }
+    removeEncryptionKeys(deleteUrl);
+}
+
+void MainWindow::loadEncryptionKeys()
+{
+    m_encryptionKeysPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                           + "/encryption-keys.jsonl";
+    
+    QFile file(m_encryptionKeysPath);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    while (!file.atEnd()) {
+        const QJsonObject record = QJsonDocument::fromJson(file.readLine()).object();
+        const QString deleteUrl = record["delete"].toString();
+        const QString rawUrl = record["raw"].toString();
+        if (deleteUrl.isEmpty() || rawUrl.isEmpty()) continue;
+        m_encryptionKeys.insert(deleteUrl, qMakePair(rawUrl, QByteArray::fromBase64(record["key"].toString().toLatin1())));
+        m_encryptionKeyDeleteUrls.insert(rawUrl, deleteUrl);
+    }
+}
+
+void MainWindow::saveEncryptionKeys()
+{
+    QSaveFile file(m_encryptionKeysPath);
+    if (!file.open(QIODevice::WriteOnly)) return;
+    
+    for (auto it = m_encryptionKeys.cbegin(); it != m_encryptionKeys.cend(); ++it) {
+        QJsonObject record;
+        record["delete"] = it.key();
+        record["raw"] = it.value().first;
+        record["key"] = QString::fromLatin1(it.value().second.toBase64());
+        file.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+    }
+    if (file.commit()) {
+        m_encryptionKeysDirty = false;
+    }
+}
+
+void MainWindow::storeEncryptionKey(const QString& rawUrl, const QString& deleteUrl, const QByteArray& key)
+{
+    m_encryptionKeys.insert(deleteUrl, qMakePair(rawUrl, key));
+    m_encryptionKeyDeleteUrls.insert(rawUrl, deleteUrl);
+    
+    // Appended right away: a lost key makes the upload unreadable
+    QJsonObject record;
+    record["delete"] = deleteUrl;
+    record["raw"] = rawUrl;
+    record["key"] = QString::fromLatin1(key.toBase64());
+    QFile file(m_encryptionKeysPath);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        file.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+    }
+}
+
+QByteArray MainWindow::encryptionKey(const QString& rawUrl) const
+{
+    return m_encryptionKeys.value(m_encryptionKeyDeleteUrls.value(rawUrl)).second;
+}
+
+void MainWindow::removeEncryptionKeys(const QString& deleteUrl)
+{
+    const auto it = m_encryptionKeys.constFind(deleteUrl);
+    if (it == m_encryptionKeys.cend()) return;
+    
+    m_encryptionKeyDeleteUrls.remove(it.value().first);
+    m_encryptionKeys.erase(it);
+    m_encryptionKeysDirty = true;  // written once the delete batch is done
 }
 
 void MainWindow::clearHistory()
 {
+    const int keys = int(m_encryptionKeys.size());
+    QString text = "Clear the upload history? Uploaded files stay on the server.";
+    if (keys > 0) {
+        text += QString("\n\nEncryption keys for %1 upload(s) stay in the keyring until those uploads are "
+                        "deleted, but cleared entries can no longer be previewed or decrypted from here.").arg(keys);
+    }
+    QMessageBox::StandardButton reply = QMessageBox::question(this, "Clear Upload History", text,
+                                                              QMessageBox::Yes | QMessageBox::No);
+    if (reply != QMessageBox::Yes) return;
+    
+    // Only forgets the local list; the expiry queue and keyring still track the files
     m_historyList->clear();
     m_historyList->setHidden(true);
     m_settings.remove("upload_history");
@@ -751,8 +1606,8 @@ void MainWindow::clearHistory()
 
 void MainWindow::onHistoryItemDoubleClicked(QListWidgetItem* item)
 {
-    QStringList urls = item->data(Qt::UserRole).toStringList();
-    if (urls.size() == 3) {
-        updatePreviewPanel(urls[0], urls[1], urls[2]);
+    const QJsonObject entry = item->data(HistoryEntryRole).toJsonObject();
+    if (!entry.isEmpty()) {
+        updatePreviewPanel(entry);
     }
 }
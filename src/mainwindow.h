@@ -2,28 +2,51 @@
 
 #include <QMainWindow>
 #include <QSettings>
-#include <QNetworkAccessManager>
 #include <QMimeData>
 #include <QUrlQuery>
 #include <QMessageBox>
-#include <QNetworkReply>
 #include <QListWidget>
 #include <QListWidgetItem>
 #include <QAction>
 #include <QStatusBar>
+#include <QThread>
+#include <QDateTime>
+#include <QHash>
+#include <QImage>
+#include <QSet>
+#include <QTimer>
+#include <QJsonObject>
 
 class QLineEdit;
 class QPushButton;
 class QLabel;
 class QProgressBar;
 class QWidget;
+class UploadEngine;
+class UploadQueue;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = nullptr);
-    ~MainWindow() override = default;
+    // settingsScope names the QSettings store; the stress harness uses its own
+    explicit MainWindow(const QString& settingsScope = "Settings", QWidget *parent = nullptr);
+    ~MainWindow() override;
+
+signals:
+    // Forwarded to the UploadEngine on the network thread (queued)
+    void apiKeysChanged(const QStringList& keys);
+    void keyRateLimitChanged(int uploadsPerMinute);
+    void mirrorsChanged(const QStringList& specs);
+    void validateApiKeyRequested(const QString& key);
+    void uploadRequested(quint64 jobId, const QString& filePath, const QString& cipher, const QByteArray& key);
+    void archiveUploadRequested(quint64 jobId, const QString& archiveName, const QStringList& sourcePaths,
+                                const QString& cipher, const QByteArray& key);
+    void previewRequested(const QUrl& url, const QSize& targetSize, const QByteArray& key);
+    void deleteRequested(const QStringList& deleteUrls);
+    void memoryBudgetChanged(qint64 bytes);
+    void verifyRequested(const QString& rawUrl, const QByteArray& expectedSha256);
+    void verifyRateLimitChanged(qint64 bytesPerSecond);
 
 protected:
     void dragEnterEvent(QDragEnterEvent* event) override;
@@ -34,49 +57,142 @@ private slots:
     void saveApiKey();
     void logout();
     void handleFileSelection();
-    void uploadProgress(qint64 bytesSent, qint64 bytesTotal);
-    void uploadFinished();
+    void uploadProgress(quint64 jobId, qint64 bytesSent, qint64 bytesTotal);
+    void uploadSucceeded(quint64 jobId, const QString& filePath, const QString& imageUrl,
+                         const QString& rawUrl, const QString& deleteUrl, const QByteArray& sha256,
+                         const QJsonObject& mirrors);
+    void uploadFailed(quint64 jobId, const QString& filePath, const QString& message, bool retryable);
+    void uploadAbandoned(quint64 jobId, const QString& name, const QString& message);
+    void dispatchUpload(quint64 jobId, const QString& kind, const QStringList& paths, const QString& name);
+    void updateQueueState(bool online, int pendingCount);
     void copyUrl();
     void openImageUrl();
-    void openDeleteUrl();
+    void deleteCurrentUpload();
+    void deleteSelectedUploads();
+    void uploadDeleted(const QString& deleteUrl, bool success, const QString& message);
+    void configureAutoDelete();
+    void expireOldUploads();
+    void configureMemoryBudget();
+    void verifySelectedUploads();
+    void verificationFinished(const QString& rawUrl, const QString& status, const QString& message);
+    void updateMemoryUsage(qint64 bytesInUse, qint64 peakBytes, qint64 budgetBytes);
     void checkAndPromptApiKey();
-    void validateApiKeyResponse(QNetworkReply* reply);
+    void validateApiKeyResponse(const QString& key, bool isValid, const QString& message);
+    void apiKeyUnverified(const QString& key, const QString& message);
+    void revalidateApiKey();
+    void apiKeyRejected(const QString& key, int remainingKeys);
+    void configureExtraApiKeys();
+    void configureKeyRateLimit();
+    void configureMirrors();
+    void configureEncryptionCipher();
     void uploadFile(const QString& filePath);
-    void previewImageDownloaded(QNetworkReply* reply);
+    void uploadFiles(const QStringList& filePaths);
+    void uploadArchive(const QStringList& sourcePaths);
+    void archiveReady(quint64 jobId, const QStringList& memberNames, qint64 uncompressedSize);
+    void previewImageDownloaded(const QUrl& url, const QImage& image);
+    void previewImageFailed(const QUrl& url);
 
 private:
     void setupUi();
+    void setupUploadEngine();
+    void setupUploadQueue();
     void createApiKeyPrompt();
     void loadHistory();
-    void addToHistory(const QString& fileName, const QString& imageUrl, 
-                     const QString& rawUrl, const QString& deleteUrl);
+    void addHistoryItem(const QJsonObject& entry);
+    void updateHistoryItem(QListWidgetItem* item, const QJsonObject& entry);
+    void addToHistory(QJsonObject entry);
+    void updateHistoryEntry(const QString& rawUrl, const QJsonObject& changes);
+    void requestVerification(const QString& rawUrl, const QByteArray& sha256);
+    void removeFromHistory(const QString& deleteUrl);
+    void requestDeletes(const QStringList& deleteUrls, bool userInitiated);
     void clearHistory();
+    void loadExpiryQueue();
+    void saveExpiryQueue();
+    // Encryption keys live outside the capped history and go away only when
+    // the upload itself is deleted
+    void loadEncryptionKeys();
+    void saveEncryptionKeys();
+    void storeEncryptionKey(const QString& rawUrl, const QString& deleteUrl, const QByteArray& key);
+    QByteArray encryptionKey(const QString& rawUrl) const;
+    void removeEncryptionKeys(const QString& deleteUrl);
     void onHistoryItemDoubleClicked(QListWidgetItem* item);
     bool hasValidApiKey() const;
     void loadApiKey();
     void updateDropAreaStyle(bool isDragOver = false);
-    void showUploadResult(const QByteArray& response);
+    void showUploadResult(const QString& filePath, const QJsonObject& entry);
+    void updateAggregateProgress();
+    void reportAbandonedUploads();
     void validateApiKey(const QString& key);
+    void extraApiKeyValidated(const QString& key, bool isValid, const QString& message);
+    void publishApiKeys();
     void updateUiForValidation(bool isValid, const QString& message = QString());
     void setupPreviewPanel();
-    void updatePreviewPanel(const QString& imageUrl, const QString& rawUrl, const QString& deleteUrl);
+    void updatePreviewPanel(const QJsonObject& entry);
     void clearPreviewPanel();
     void downloadPreviewImage();
-    QString getMimeType(const QString& filePath);
     bool isImageFile(const QString& filePath) const;
 
     static bool isValidFileType(const QString& filePath);
     static bool isFileSizeValid(const QString& filePath);
 
+    // Full history entry JSON, alongside the URL list in Qt::UserRole
+    static constexpr int HistoryEntryRole = Qt::UserRole + 1;
+
     QSettings m_settings;
     QString m_apiKey;
-    QNetworkAccessManager m_networkManager;
-    QNetworkReply* m_currentUpload = nullptr;
+    
+    // Further keys uploads are load balanced across, next to m_apiKey
+    static constexpr int UploadsPerKey = 4;
+    QStringList m_extraApiKeys;
+    QSet<QString> m_pendingKeyValidations;
+    QStringList m_rejectedExtraKeys;
+    // Stored key that could not be checked (offline); uploads queue up and
+    // are released once it validates after connectivity returns
+    bool m_apiKeyUnverified = false;
+    QTimer m_revalidateTimer;
+
+    // Network I/O runs on its own thread; see UploadEngine
+    QThread m_networkThread;
+    UploadEngine* m_uploadEngine = nullptr;
+    
+    // Journaled queue that hands out job ids and holds uploads while offline
+    UploadQueue* m_uploadQueue = nullptr;
+
+    // In-flight uploads: job id -> (bytes sent, bytes total)
+    QHash<quint64, QPair<qint64, qint64>> m_activeUploads;
+    QHash<quint64, QStringList> m_archiveMembers;
+    // Cipher and key of in-flight encrypted uploads, recorded in history
+    QHash<quint64, QPair<QString, QByteArray>> m_jobEncryption;
+    // Uploads given up on; reported once the running batch has drained
+    QStringList m_abandonedUploads;
+
+    // Deletions handed to the engine; failures are reported once per batch
+    QSet<QString> m_deletesInFlight;
+    QSet<QString> m_userDeletes;
+    // Uploads auto-delete will purge (delete URL -> upload time), not capped
+    // like the history. Kept in memory; new uploads are appended to the file
+    // and it is rewritten once per delete batch.
+    QString m_expiryQueuePath;
+    QHash<QString, QDateTime> m_expiryQueue;
+    bool m_expiryQueueDirty = false;
+    // Keyring of encrypted uploads (delete URL -> raw URL and key, plus the
+    // reverse lookup for previews), persisted the same way as the queue
+    QString m_encryptionKeysPath;
+    QHash<QString, QPair<QString, QByteArray>> m_encryptionKeys;
+    QHash<QString, QString> m_encryptionKeyDeleteUrls;
+    bool m_encryptionKeysDirty = false;
+    QStringList m_deleteFailures;
+    int m_deletedCount = 0;
+    QTimer m_expiryTimer;
+    int m_verificationsInFlight = 0;
 
     // Upload URLs
     QString m_currentImageUrl;
     QString m_currentRawUrl;
     QString m_currentDeleteUrl;
+    // Set for encrypted uploads, whose preview is the decrypted raw file
+    QByteArray m_currentEncryptionKey;
+    QString m_previewUrl;
 
     // UI Elements
     QLineEdit* m_apiKeyInput = nullptr;
@@ -88,6 +204,8 @@ private:
     QLabel* m_dropLabel = nullptr;
     QPushButton* m_selectButton = nullptr;
     QProgressBar* m_progressBar = nullptr;
+    QLabel* m_memoryLabel = nullptr;
+    QLabel* m_queueLabel = nullptr;
 
     // Preview Panel Elements
     QWidget* m_previewPanel = nullptr;
@@ -102,4 +220,15 @@ private:
     QListWidget* m_historyList;
     QAction* m_clearHistoryAction;
     QAction* m_autoCopyAction;
+    QAction* m_deleteSelectedAction = nullptr;
+    QAction* m_autoDeleteAction = nullptr;
+    QAction* m_archiveAction = nullptr;
+    QAction* m_memoryBudgetAction = nullptr;
+    QAction* m_verifyAction = nullptr;
+    QAction* m_verifySelectedAction = nullptr;
+    QAction* m_extraKeysAction = nullptr;
+    QAction* m_keyRateAction = nullptr;
+    QAction* m_mirrorsAction = nullptr;
+    QAction* m_encryptAction = nullptr;
+    QAction* m_cipherAction = nullptr;
 };
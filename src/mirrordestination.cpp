@@ -0,0 +1,160 @@
+#include "mirrordestination.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QMessageAuthenticationCode>
+#include <QRandomGenerator>
+#include <QStringList>
+
+MirrorDestination MirrorDestination::parse(const QString& spec, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return MirrorDestination();
+    };
+
+    const QStringList fields = spec.simplified().split(' ', Qt::SkipEmptyParts);
+    if (fields.size() < 2) {
+        return fail("Expected \"<webdav|s3> <url> [credentials]\"");
+    }
+
+    MirrorDestination destination;
+    const QString kind = fields[0].toLower();
+    if (kind == "webdav") {
+        destination.m_kind = Kind::WebDav;
+    } else if (kind == "s3") {
+        destination.m_kind = Kind::S3;
+    } else {
+        return fail("Unknown mirror type \"" + fields[0] + "\"");
+    }
+
+    QUrl url(fields[1], QUrl::StrictMode);
+    if (!url.isValid() || url.host().isEmpty() ||
+        (url.scheme() != "https" && url.scheme() != "http")) {
+        return fail("Invalid mirror URL \"" + fields[1] + "\"");
+    }
+
+    if (fields.size() > 2) {
+        const qsizetype colon = fields[2].indexOf(':');
+        if (colon <= 0) {
+            return fail("Credentials must be written as user:secret");
+        }
+        destination.m_user = fields[2].left(colon);
+        destination.m_secret = fields[2].mid(colon + 1);
+    }
+    if (fields.size() > 3) {
+        destination.m_region = fields[3];
+    }
+
+    if (destination.m_kind == Kind::S3) {
+        if (destination.m_user.isEmpty()) {
+            return fail("S3 mirrors need accessKey:secretKey credentials");
+        }
+        if (url.path().section('/', 1, 1).isEmpty()) {
+            return fail("S3 mirror URLs must include the bucket, e.g. https://host/bucket");
+        }
+    }
+
+    // Object names are appended to the base path
+    QString path = url.path();
+    while (path.endsWith('/')) path.chop(1);
+    url.setPath(path);
+    destination.m_baseUrl = url;
+    return destination;
+}
+
+QString MirrorDestination::name() const
+{
+    return m_baseUrl.host() + m_baseUrl.path();
+}
+
+QString MirrorDestination::uniqueObjectKey(const QString& fileName)
+{
+    // Sortable by upload time and still recognisable by name; the random
+    // part keeps same-named uploads within one second apart
+    return QDateTime::currentDateTimeUtc().toString("yyyyMMdd-HHmmss") + '-' +
+           QString::number(QRandomGenerator::global()->generate(), 16).rightJustified(8, '0') + '-' +
+           fileName;
+}
+
+QUrl MirrorDestination::objectUrl(const QString& objectKey) const
+{
+    // Every segment percent-encoded exactly once, as SigV4 expects the
+    // canonical URI to match the path sent on the wire
+    QByteArray path;
+    for (const QString& segment : m_baseUrl.path().split('/', Qt::SkipEmptyParts)) {
+        path += '/' + QUrl::toPercentEncoding(segment);
+    }
+    path += '/' + QUrl::toPercentEncoding(objectKey);
+
+    QUrl url = m_baseUrl;
+    url.setPath(QString::fromLatin1(path), QUrl::TolerantMode);
+    return url;
+}
+
+QNetworkRequest MirrorDestination::putRequest(const QString& objectKey, const QString& mimeType, qint64 size) const
+{
+    const QUrl url = objectUrl(objectKey);
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, mimeType);
+    request.setHeader(QNetworkRequest::ContentLengthHeader, size);
+    // Stream from the fan-out ring; a slow mirror then holds it back instead of taking RAM
+    request.setAttribute(QNetworkRequest::DoNotBufferUploadDataAttribute, true);
+
+    if (m_kind == Kind::S3) {
+        signS3(request, url);
+    } else if (!m_user.isEmpty()) {
+        request.setRawHeader("Authorization", "Basic " + (m_user + ':' + m_secret).toUtf8().toBase64());
+    }
+    return request;
+}
+
+void MirrorDestination::signS3(QNetworkRequest& request, const QUrl& url) const
+{
+    auto hmac = [](const QByteArray& key, const QByteArray& message) {
+        return QMessageAuthenticationCode::hash(message, key, QCryptographicHash::Sha256);
+    };
+
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    const QByteArray amzDate = now.toString("yyyyMMdd'T'HHmmss'Z'").toLatin1();
+    const QByteArray date = amzDate.left(8);
+    const QByteArray region = m_region.toUtf8();
+    const QByteArray scope = date + '/' + region + "/s3/aws4_request";
+
+    // Qt adds the port to Host only when it is not the scheme default
+    QByteArray host = url.host().toUtf8();
+    if (url.port() != -1 && url.port() != (url.scheme() == "https" ? 443 : 80)) {
+        host += ':' + QByteArray::number(url.port());
+    }
+
+    const QByteArray payloadHash = "UNSIGNED-PAYLOAD";
+    const QByteArray signedHeaders = "host;x-amz-content-sha256;x-amz-date";
+    const QByteArray canonicalRequest =
+        "PUT\n" +
+        url.path(QUrl::FullyEncoded).toLatin1() + "\n"
+        "\n" +
+        "host:" + host + "\n"
+        "x-amz-content-sha256:" + payloadHash + "\n"
+        "x-amz-date:" + amzDate + "\n"
+        "\n" +
+        signedHeaders + "\n" +
+        payloadHash;
+
+    const QByteArray stringToSign =
+        "AWS4-HMAC-SHA256\n" +
+        amzDate + "\n" +
+        scope + "\n" +
+        QCryptographicHash::hash(canonicalRequest, QCryptographicHash::Sha256).toHex();
+
+    QByteArray key = hmac("AWS4" + m_secret.toUtf8(), date);
+    key = hmac(key, region);
+    key = hmac(key, "s3");
+    key = hmac(key, "aws4_request");
+    const QByteArray signature = hmac(key, stringToSign).toHex();
+
+    request.setRawHeader("x-amz-date", amzDate);
+    request.setRawHeader("x-amz-content-sha256", payloadHash);
+    request.setRawHeader("Authorization",
+                         "AWS4-HMAC-SHA256 Credential=" + m_user.toUtf8() + '/' + scope +
+                         ", SignedHeaders=" + signedHeaders +
+                         ", Signature=" + signature);
+}
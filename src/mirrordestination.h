@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QNetworkRequest>
+#include <QString>
+#include <QUrl>
+
+// A secondary location every upload is copied to, configured as one line:
+//
+//     webdav https://dav.example.com/uploads [user:password]
+//     s3 https://s3.example.com/bucket[/prefix] accessKey:secretKey [region]
+//
+// WebDAV mirrors get a plain PUT with basic auth. S3-compatible mirrors use
+// path-style URLs and AWS Signature V4 with an unsigned payload, so the
+// body can be streamed without hashing it first. Plain http:// is accepted
+// for local stand-in servers.
+class MirrorDestination {
+public:
+    enum class Kind {
+        WebDav,
+        S3
+    };
+
+    // Returns an invalid destination and sets error on malformed lines
+    static MirrorDestination parse(const QString& spec, QString* error = nullptr);
+
+    bool isValid() const { return m_baseUrl.isValid(); }
+    QString name() const;
+
+    // Object keys must be unique per upload: a PUT replaces whatever is
+    // stored under the same key. See uniqueObjectKey().
+    static QString uniqueObjectKey(const QString& fileName);
+
+    // URL the object is stored at
+    QUrl objectUrl(const QString& objectKey) const;
+    QNetworkRequest putRequest(const QString& objectKey, const QString& mimeType, qint64 size) const;
+
+private:
+    void signS3(QNetworkRequest& request, const QUrl& url) const;
+
+    Kind m_kind = Kind::WebDav;
+    QUrl m_baseUrl;
+    QString m_user;
+    QString m_secret;
+    QString m_region = "us-east-1";
+};
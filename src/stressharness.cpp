@@ -0,0 +1,358 @@
+#include "stressharness.h"
+#include "eventloopmonitor.h"
+#include "mainwindow.h"
+#include <QApplication>
+#include <QBuffer>
+#include <QDateTime>
+#include <QDir>
+#include <QDropEvent>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QListWidget>
+#include <QMimeData>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QThread>
+#include <atomic>
+
+// Minimal HTTP/1.1 stand-in for the E-Z API on its own thread, so serving
+// requests does not load the GUI thread being measured. Upload bodies are
+// discarded as they arrive; every image URL serves the same PNG.
+class MockServer {
+public:
+    explicit MockServer(const QByteArray& image)
+        : m_image(image)
+    {
+    }
+
+    ~MockServer()
+    {
+        // Sockets are children of the server and go with it
+        if (m_server) {
+            QMetaObject::invokeMethod(&m_dispatcher, [this]() { delete m_server; },
+                                      Qt::BlockingQueuedConnection);
+        }
+        m_thread.quit();
+        m_thread.wait();
+    }
+
+    bool start()
+    {
+        m_dispatcher.moveToThread(&m_thread);
+        m_thread.setObjectName("MockServer");
+        m_thread.start();
+
+        bool listening = false;
+        QMetaObject::invokeMethod(&m_dispatcher, [this, &listening]() {
+            m_server = new QTcpServer;
+            QObject::connect(m_server, &QTcpServer::newConnection, m_server, [this]() {
+                while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+                    serve(socket);
+                }
+            });
+            listening = m_server->listen(QHostAddress::LocalHost);
+            m_port = m_server->serverPort();
+        }, Qt::BlockingQueuedConnection);
+        return listening;
+    }
+
+    QString baseUrl() const { return QString("http://127.0.0.1:%1").arg(m_port); }
+    int uploadsReceived() const { return m_uploads; }
+
+private:
+    struct Connection {
+        QByteArray pending;
+        QByteArray method;
+        QByteArray path;
+        qint64 bodyRemaining = 0;
+        bool inBody = false;
+    };
+
+    void serve(QTcpSocket* socket)
+    {
+        auto connection = std::make_shared<Connection>();
+        QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket, connection]() {
+            connection->pending.append(socket->readAll());
+            while (true) {
+                if (connection->inBody) {
+                    const qint64 n = qMin<qint64>(connection->bodyRemaining, connection->pending.size());
+                    connection->pending.remove(0, n);
+                    connection->bodyRemaining -= n;
+                    if (connection->bodyRemaining > 0) return;
+                    connection->inBody = false;
+                    respond(socket, connection->method, connection->path);
+                    continue;
+                }
+
+                const qsizetype headerEnd = connection->pending.indexOf("\r\n\r\n");
+                if (headerEnd < 0) return;
+
+                const QList<QByteArray> lines = connection->pending.left(headerEnd).split('\n');
+                const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+                connection->method = requestLine.value(0);
+                connection->path = requestLine.value(1);
+                connection->bodyRemaining = 0;
+                for (const QByteArray& line : lines) {
+                    if (line.toLower().startsWith("content-length:")) {
+                        connection->bodyRemaining = line.mid(15).trimmed().toLongLong();
+                    }
+                }
+                connection->pending.remove(0, headerEnd + 4);
+                connection->inBody = true;
+            }
+        });
+    }
+
+    void respond(QTcpSocket* socket, const QByteArray& method, const QByteArray& path)
+    {
+        QByteArray contentType = "application/json";
+        QByteArray body;
+
+        if (method == "POST" && path.startsWith("/files")) {
+            const int id = ++m_uploads;
+            QJsonObject data;
+            data["url"] = QString("%1/i/%2.png").arg(baseUrl()).arg(id);
+            data["raw"] = QString("%1/r/%2.png").arg(baseUrl()).arg(id);
+            data["delete"] = QString("%1/d/%2").arg(baseUrl()).arg(id);
+            QJsonObject response;
+            response["success"] = true;
+            response["data"] = data;
+            body = QJsonDocument(response).toJson(QJsonDocument::Compact);
+        } else if (path.startsWith("/i/") || path.startsWith("/r/")) {
+            contentType = "image/png";
+            body = m_image;
+        } else {
+            // Key validation, deletes and mirror PUTs only need a 200
+            body = "{}";
+        }
+
+        socket->write("HTTP/1.1 200 OK\r\n"
+                      "Content-Type: " + contentType + "\r\n"
+                      "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                      "Connection: keep-alive\r\n"
+                      "\r\n" + body);
+    }
+
+    QThread m_thread;
+    // Context object living on m_thread for setup and teardown calls
+    QObject m_dispatcher;
+    QTcpServer* m_server = nullptr;
+    QByteArray m_image;
+    std::atomic<int> m_uploads{0};
+    quint16 m_port = 0;
+};
+
+namespace {
+
+QImage makeTestImage(int width, int height, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    QImage image(width, height, QImage::Format_RGB32);
+    image.fill(QColor::fromRgb(random.generate()));
+
+    // Some structure so PNG output is not trivially small
+    QPainter painter(&image);
+    for (int i = 0; i < 40; ++i) {
+        painter.fillRect(random.bounded(width), random.bounded(height),
+                         random.bounded(1, width / 2 + 2), random.bounded(1, height / 2 + 2),
+                         QColor::fromRgb(random.generate()));
+    }
+    return image;
+}
+
+QString formatSummary(const QString& name, const EventLoopMonitor::Summary& summary)
+{
+    return QString("%1 %2 %3 %4 %5 %6")
+        .arg(name, -16)
+        .arg(qulonglong(summary.samples), 8)
+        .arg(summary.p50, 8, 'f', 2)
+        .arg(summary.p95, 8, 'f', 2)
+        .arg(summary.p99, 8, 'f', 2)
+        .arg(summary.max, 8, 'f', 2);
+}
+
+} // namespace
+
+StressHarness::StressHarness(const Options& options, QObject *parent)
+    : QObject(parent)
+    , m_options(options)
+{
+    m_dropTimer.setInterval(250);
+    connect(&m_dropTimer, &QTimer::timeout, this, &StressHarness::dropNextBatch);
+
+    m_browseTimer.setInterval(40);
+    connect(&m_browseTimer, &QTimer::timeout, this, &StressHarness::browseHistory);
+
+    m_promptTimer.setInterval(50);
+    connect(&m_promptTimer, &QTimer::timeout, this, &StressHarness::dismissPrompts);
+
+    m_progressTimer.setInterval(250);
+    connect(&m_progressTimer, &QTimer::timeout, this, &StressHarness::checkProgress);
+
+    m_timeoutTimer.setSingleShot(true);
+    connect(&m_timeoutTimer, &QTimer::timeout, this, [this]() { finish(true); });
+}
+
+StressHarness::~StressHarness() = default;
+
+bool StressHarness::prepare()
+{
+    QTextStream err(stderr);
+    if (!m_dataDir.isValid()) {
+        err << "stress: cannot create a temporary directory\n";
+        return false;
+    }
+
+    // Dedicated store, wiped every run: no mirrors, encryption, expiry or
+    // history carried over, and nothing written to the user's settings
+    QSettings settings("E-Z Uploader", SettingsScope);
+    settings.clear();
+    settings.setValue("api_key", "stress-key-0");
+    QStringList extraKeys;
+    for (int i = 1; i < m_options.apiKeys; ++i) {
+        extraKeys.append(QString("stress-key-%1").arg(i));
+    }
+    settings.setValue("extra_api_keys", extraKeys);
+    settings.sync();
+
+    // The application name was switched for this run, so these are the
+    // harness's own journal and expiry queue
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QFile::remove(dataDir + "/upload-journal.jsonl");
+    QFile::remove(dataDir + "/expiry-queue.jsonl");
+
+    // A spread of sizes, from thumbnails to multi-megabyte screenshots
+    QTextStream(stdout) << "stress: generating " << m_options.files << " images\n";
+    for (int i = 0; i < m_options.files; ++i) {
+        const int side = 64 << (i % 5);
+        const QString path = QDir(m_dataDir.path()).filePath(QString("stress-%1.png").arg(i));
+        if (!makeTestImage(side, side * 3 / 4, quint32(i)).save(path)) {
+            err << "stress: cannot write " << path << "\n";
+            return false;
+        }
+        m_files.append(path);
+    }
+
+    QByteArray preview;
+    QBuffer previewBuffer(&preview);
+    previewBuffer.open(QIODevice::WriteOnly);
+    makeTestImage(800, 600, 0xe2).save(&previewBuffer, "PNG");
+
+    m_server = std::make_unique<MockServer>(preview);
+    if (!m_server->start()) {
+        err << "stress: mock server failed to listen\n";
+        return false;
+    }
+
+    qputenv("EZ_UPLOAD_URL", (m_server->baseUrl() + "/files").toUtf8());
+    qputenv("EZ_VALIDATE_URL", (m_server->baseUrl() + "/paste/config").toUtf8());
+    return true;
+}
+
+void StressHarness::run(MainWindow* window)
+{
+    m_window = window;
+    m_monitor = new EventLoopMonitor(window, this);
+    m_monitor->start();
+
+    m_dropTimer.start();
+    m_browseTimer.start();
+    m_promptTimer.start();
+    m_progressTimer.start();
+    m_timeoutTimer.start(m_options.timeoutSeconds * 1000);
+}
+
+void StressHarness::dropNextBatch()
+{
+    if (m_nextFile >= m_files.size()) {
+        m_dropTimer.stop();
+        return;
+    }
+
+    QList<QUrl> urls;
+    for (int i = 0; i < m_options.batchSize && m_nextFile < m_files.size(); ++i) {
+        urls.append(QUrl::fromLocalFile(m_files[m_nextFile++]));
+    }
+
+    // Delivered through the same handler as a real drag and drop
+    QMimeData mimeData;
+    mimeData.setUrls(urls);
+    QDropEvent event(QPointF(10, 10), Qt::CopyAction, &mimeData, Qt::LeftButton, Qt::NoModifier);
+    QCoreApplication::sendEvent(m_window, &event);
+}
+
+void StressHarness::browseHistory()
+{
+    auto* history = m_window->findChild<QListWidget*>();
+    if (!history || history->count() == 0) return;
+
+    QListWidgetItem* item = history->item(QRandomGenerator::global()->bounded(history->count()));
+    history->setCurrentItem(item);
+    emit history->itemDoubleClicked(item);
+    ++m_historyOpens;
+}
+
+void StressHarness::dismissPrompts()
+{
+    // Message boxes run a nested loop; the monitor keeps sampling inside it
+    if (QWidget* modal = QApplication::activeModalWidget()) {
+        modal->close();
+        ++m_promptsDismissed;
+    }
+}
+
+void StressHarness::checkProgress()
+{
+    if (m_server->uploadsReceived() < m_files.size()) return;
+
+    // Let the last results, history writes and previews settle
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (m_doneSince < 0) {
+        m_doneSince = now;
+    } else if (now - m_doneSince >= 1000) {
+        finish(false);
+    }
+}
+
+void StressHarness::finish(bool timedOut)
+{
+    m_dropTimer.stop();
+    m_browseTimer.stop();
+    m_promptTimer.stop();
+    m_progressTimer.stop();
+    m_timeoutTimer.stop();
+    m_monitor->stop();
+
+    const EventLoopMonitor::Summary lag = m_monitor->lag();
+    const bool lagOk = lag.p99 <= m_options.maxP99LagMs;
+
+    QTextStream out(stdout);
+    out << "\nstress: " << m_server->uploadsReceived() << "/" << m_files.size() << " uploads, "
+        << m_options.apiKeys << " API keys, " << m_historyOpens << " history opens, "
+        << m_promptsDismissed << " prompts dismissed\n";
+    out << QString("%1 %2 %3 %4 %5 %6\n").arg("(ms)", -16).arg("samples", 8)
+           .arg("p50", 8).arg("p95", 8).arg("p99", 8).arg("max", 8);
+    out << formatSummary("event-loop lag", lag) << "\n";
+    out << formatSummary("input latency", m_monitor->inputLatency()) << "\n";
+    out << formatSummary("paint time", m_monitor->paintTime()) << "\n";
+
+    if (timedOut) {
+        out << "FAIL: uploads did not finish within " << m_options.timeoutSeconds << " s\n";
+    } else if (!lagOk) {
+        out << "FAIL: p99 event-loop lag " << lag.p99 << " ms exceeds " << m_options.maxP99LagMs << " ms\n";
+    } else {
+        out << "PASS\n";
+    }
+    out.flush();
+
+    QCoreApplication::exit(timedOut || !lagOk ? 1 : 0);
+}
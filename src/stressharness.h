@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <memory>
+
+class EventLoopMonitor;
+class MainWindow;
+class MockServer;
+
+// Headless load test for GUI responsiveness (run with --stress). Points the
+// upload engine at an in-process mock E-Z server, drops generated images
+// onto the window in bursts, spreads them over enough API keys to keep
+// hundreds of jobs in flight, browses the history while uploads land and
+// dismisses every prompt that pops up. EventLoopMonitor samples the GUI
+// thread throughout; the run fails if p99 event-loop lag exceeds the limit
+// or the uploads do not finish in time.
+class StressHarness : public QObject {
+    Q_OBJECT
+
+public:
+    // QSettings scope the harness seeds and hands to its MainWindow, so a
+    // run never reads or writes the user's "Settings" store
+    static constexpr const char* SettingsScope = "Stress Settings";
+
+    struct Options {
+        int files = 200;
+        int batchSize = 20;
+        int apiKeys = 25;
+        int timeoutSeconds = 120;
+        double maxP99LagMs = 50;
+    };
+
+    explicit StressHarness(const Options& options, QObject *parent = nullptr);
+    ~StressHarness() override;
+
+    // Isolated settings, test files and the mock server; call before the
+    // MainWindow is constructed so it picks all of them up
+    bool prepare();
+    // Drives the window and exits the application with 0 (pass) or 1
+    void run(MainWindow* window);
+
+private:
+    void dropNextBatch();
+    void browseHistory();
+    void dismissPrompts();
+    void checkProgress();
+    void finish(bool timedOut);
+
+    Options m_options;
+    QTemporaryDir m_dataDir;
+    QStringList m_files;
+    qsizetype m_nextFile = 0;
+    std::unique_ptr<MockServer> m_server;
+
+    MainWindow* m_window = nullptr;
+    EventLoopMonitor* m_monitor = nullptr;
+    QTimer m_dropTimer;
+    QTimer m_browseTimer;
+    QTimer m_promptTimer;
+    QTimer m_progressTimer;
+    QTimer m_timeoutTimer;
+    int m_promptsDismissed = 0;
+    int m_historyOpens = 0;
+    qint64 m_doneSince = -1;
+};
@@ -0,0 +1,860 @@
+#include "uploadengine.h"
+#include "archivestream.h"
+#include "encryptingdevice.h"
+#include "fanoutbuffer.h"
+#include "hashingdevice.h"
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QHttpMultiPart>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QUrlQuery>
+#include <QTimer>
+#include <QRandomGenerator>
+#include <QImageReader>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// The pieces a preview download was received in, addressed as one range
+struct Segments {
+    std::vector<std::pair<char*, qint64>> parts;
+
+    template <typename Copy>
+    bool visit(qint64 offset, qint64 size, Copy copy) const
+    {
+        for (const auto& [data, length] : parts) {
+            if (size == 0) break;
+            if (offset >= length) {
+                offset -= length;
+                continue;
+            }
+            const qint64 n = qMin(size, length - offset);
+            copy(data + offset, n);
+            size -= n;
+            offset = 0;
+        }
+        return size == 0;
+    }
+
+    bool read(qint64 offset, char* out, qint64 size) const
+    {
+        return visit(offset, size, [&out](const char* data, qint64 n) {
+            std::memcpy(out, data, size_t(n));
+            out += n;
+        });
+    }
+
+    void write(qint64 offset, const char* in, qint64 size) const
+    {
+        visit(offset, size, [&in](char* data, qint64 n) {
+            std::memcpy(data, in, size_t(n));
+            in += n;
+        });
+    }
+};
+
+// Lets the image decoder read the segments where they lie
+class SegmentDevice : public QIODevice {
+public:
+    SegmentDevice(const Segments& segments, qint64 size)
+        : m_segments(segments)
+        , m_size(size)
+    {
+        // Unbuffered so pos() in readData() is the offset being read
+        open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+
+    qint64 size() const override { return m_size; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override
+    {
+        const qint64 n = qBound<qint64>(0, maxSize, m_size - pos());
+        return m_segments.read(pos(), data, n) ? n : -1;
+    }
+
+    qint64 writeData(const char*, qint64) override
+    {
+        return -1;
+    }
+
+private:
+    const Segments& m_segments;
+    qint64 m_size;
+};
+
+} // namespace
+
+UploadEngine::UploadEngine(QObject *parent)
+    : QObject(parent)
+    // Parented to the engine so it follows it into the worker thread
+    , m_networkManager(new QNetworkAccessManager(this))
+    , m_bufferPool(BufferPool::create(DefaultMemoryBudget))
+    , m_poolTimer(new QTimer(this))
+    // Overridable so the stress harness can point the engine at a mock server
+    , m_uploadUrl(qEnvironmentVariable("EZ_UPLOAD_URL", "https://api.e-z.host/files"))
+    , m_validateUrl(qEnvironmentVariable("EZ_VALIDATE_URL", "https://api.e-z.gg/paste/config"))
+{
+    // Resumes uploads that were waiting for a rate-limited key
+    m_keyTimer = new QTimer(this);
+    m_keyTimer->setSingleShot(true);
+    connect(m_keyTimer, &QTimer::timeout, this, &UploadEngine::startWaitingUploads);
+
+    // Publishes the usage metric and retries previews paused on the budget
+    m_poolTimer->setInterval(250);
+    connect(m_poolTimer, &QTimer::timeout, this, [this]() {
+        // drainPreview() may abort a reply and erase it, so iterate a copy
+        std::vector<QNetworkReply*> paused;
+        for (const auto& entry : m_previews) {
+            paused.push_back(entry.first);
+        }
+        for (QNetworkReply* reply : paused) {
+            drainPreview(reply);
+        }
+        reportMemoryUsage();
+    });
+    m_poolTimer->start();
+
+    // Refills the verification token bucket ten times a second
+    m_verifyTimer = new QTimer(this);
+    m_verifyTimer->setInterval(100);
+    connect(m_verifyTimer, &QTimer::timeout, this, [this]() {
+        m_verifyTokens = qMin(m_verifyTokens + m_verifyRate / 10, m_verifyRate / 2);
+
+        std::vector<QNetworkReply*> active;
+        for (const auto& entry : m_verifications) {
+            active.push_back(entry.first);
+        }
+        for (QNetworkReply* reply : active) {
+            drainVerification(reply);
+        }
+    });
+}
+
+UploadEngine::~UploadEngine()
+{
+    // Replies own streams and previews that hold pool blocks; drop them
+    // while the rest of the engine is still intact
+    m_previews.clear();
+    m_verifications.clear();
+    delete m_networkManager;
+}
+
+void UploadEngine::setMemoryBudget(qint64 bytes)
+{
+    m_bufferPool->setBudget(bytes);
+    reportMemoryUsage();
+}
+
+void UploadEngine::reportMemoryUsage()
+{
+    const qint64 inUse = m_bufferPool->bytesInUse();
+    if (inUse == m_reportedUsage) return;
+
+    m_reportedUsage = inUse;
+    emit memoryUsageChanged(inUse, m_bufferPool->peakBytesInUse(), m_bufferPool->budget());
+}
+
+void UploadEngine::setApiKeys(const QStringList& keys)
+{
+    m_keys.setKeys(keys);
+    startWaitingUploads();
+}
+
+void UploadEngine::setKeyRateLimit(int uploadsPerMinute)
+{
+    m_keys.setRateLimit(uploadsPerMinute);
+    startWaitingUploads();
+}
+
+void UploadEngine::setMirrors(const QStringList& specs)
+{
+    // Specs were checked when entered; anything malformed is skipped
+    m_mirrors.clear();
+    for (const QString& spec : specs) {
+        MirrorDestination mirror = MirrorDestination::parse(spec);
+        if (mirror.isValid()) {
+            m_mirrors.append(mirror);
+        }
+    }
+}
+
+void UploadEngine::validateApiKey(const QString& key)
+{
+    QUrl url(m_validateUrl);
+    QUrlQuery query;
+    query.addQueryItem("key", key);
+    url.setQuery(query);
+
+    QNetworkRequest request(url);
+    QNetworkReply* reply = m_networkManager->get(request);
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, key]() {
+        reply->deleteLater();
+
+        // Only an answer from the server says anything about the key; being
+        // offline or a server outage must not cost the user their key
+        const QVariant status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+        const int statusCode = status.toInt();
+        if (!status.isValid() || statusCode >= 500) {
+            emit apiKeyUnverified(key, "Could not reach the server: " + reply->errorString());
+            return;
+        }
+
+        if (statusCode == 200) {
+            emit apiKeyValidated(key, true, QString());
+        } else {
+            emit apiKeyValidated(key, false, "Invalid API Key");
+        }
+    });
+}
+
+void UploadEngine::upload(quint64 jobId, const QString& filePath, const QString& cipher, const QByteArray& key)
+{
+    // Only reached in a race with the last key being refused; the window
+    // holds the queue until a key is entered again
+    if (!m_keys.hasUsableKeys()) {
+        emit uploadFailed(jobId, filePath, "Please enter a valid API key first.", true);
+        return;
+    }
+
+    QFile* file = new QFile(filePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        emit uploadFailed(jobId, filePath, "Failed to open file: " + file->errorString(), false);
+        delete file;
+        return;
+    }
+
+    sendEncrypted(jobId, filePath, QFileInfo(filePath).fileName(), mimeTypeFor(filePath), file, cipher, key);
+}
+
+void UploadEngine::uploadArchive(quint64 jobId, const QString& archiveName, const QStringList& sourcePaths,
+                                 const QString& cipher, const QByteArray& key)
+{
+    if (!m_keys.hasUsableKeys()) {
+        emit uploadFailed(jobId, archiveName, "Please enter a valid API key first.", true);
+        return;
+    }
+
+    auto* archive = new ArchiveStream(sourcePaths, m_bufferPool, MaxUploadSize, this);
+
+    connect(archive, &ArchiveStream::failed, this, [this, jobId, archiveName, archive](const QString& message) {
+        archive->deleteLater();
+        emit uploadFailed(jobId, archiveName, message, false);
+    });
+    connect(archive, &ArchiveStream::sizeKnown, this, [this, jobId, archiveName, archive, cipher, key](qint64 size) {
+        emit archiveReady(jobId, archive->memberNames(), archive->uncompressedSize());
+
+        // The stream already enforced the limit; encryption adds a little on top
+        const qint64 uploadSize = key.isEmpty() ? size : EncryptingDevice::encryptedSize(size);
+        if (uploadSize > MaxUploadSize) {
+            archive->deleteLater();
+            emit uploadFailed(jobId, archiveName, "Archive is larger than 100MB after compression", false);
+            return;
+        }
+
+        archive->open(QIODevice::ReadOnly);
+        sendEncrypted(jobId, archiveName, archiveName, ArchiveStream::mimeType(), archive, cipher, key);
+    });
+
+    archive->start();
+}
+
+void UploadEngine::sendEncrypted(quint64 jobId, const QString& filePath, const QString& fileName,
+                                 const QString& mimeType, QIODevice* body, const QString& cipher,
+                                 const QByteArray& key)
+{
+    if (key.isEmpty()) {
+        sendUpload(jobId, filePath, fileName, mimeType, body);
+        return;
+    }
+
+    // Encrypted while QNAM reads the body; the server only sees an opaque blob
+    auto* encrypted = new EncryptingDevice(body, cipher, key);
+    if (!encrypted->isOpen()) {
+        const QString message = encrypted->errorString();
+        encrypted->deleteLater();
+        emit uploadFailed(jobId, filePath, message, false);
+        return;
+    }
+    sendUpload(jobId, filePath, fileName + ".enc", "application/octet-stream", encrypted);
+}
+
+void UploadEngine::sendUpload(quint64 jobId, const QString& filePath, const QString& fileName,
+                              const QString& mimeType, QIODevice* body)
+{
+    // Held by the engine until a key is free to send it
+    body->setParent(this);
+    m_waitingUploads.append({jobId, filePath, fileName, mimeType, body});
+    startWaitingUploads();
+}
+
+void UploadEngine::startWaitingUploads()
+{
+    while (!m_waitingUploads.isEmpty()) {
+        const QString key = m_keys.acquire();
+        if (key.isEmpty()) break;
+
+        const WaitingUpload waiting = m_waitingUploads.takeFirst();
+        postUpload(key, waiting.jobId, waiting.filePath, waiting.fileName, waiting.mimeType, waiting.body);
+    }
+
+    if (m_waitingUploads.isEmpty()) return;
+
+    const qint64 wait = m_keys.msUntilAvailable();
+    if (wait >= 0) {
+        m_keyTimer->start(int(qMin<qint64>(wait, 60 * 1000)));
+        return;
+    }
+
+    // Every key was rejected; hand the jobs back as retryable so they stay
+    // journaled while the window holds the queue for a new key
+    const QList<WaitingUpload> orphaned = std::exchange(m_waitingUploads, {});
+    for (const WaitingUpload& waiting : orphaned) {
+        waiting.body->deleteLater();
+        emit uploadFailed(waiting.jobId, waiting.filePath, "No valid API key is available", true);
+    }
+}
+
+void UploadEngine::postUpload(const QString& key, quint64 jobId, const QString& filePath,
+                              const QString& fileName, const QString& mimeType, QIODevice* body)
+{
+    // Streamed bodies (archives) can have no data yet, which QHttpMultiPart
+    // would take for the end of the body
+    if (!m_mirrors.isEmpty() || body->isSequential()) {
+        postFanOut(key, jobId, filePath, fileName, mimeType, body);
+        return;
+    }
+
+    QHttpMultiPart* multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+
+    // Add file part with proper MIME type
+    QHttpPart filePart;
+    filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant(mimeType));
+    filePart.setHeader(QNetworkRequest::ContentDispositionHeader,
+                      QVariant(QString("form-data; name=\"file\"; filename=\"%1\"").arg(fileName)));
+    // The digest is computed as the body is sent and used for verification
+    auto* hashingBody = new HashingDevice(body, QCryptographicHash::Sha256);
+    filePart.setBodyDevice(hashingBody);
+    multiPart->append(filePart);
+
+    // Create and send request
+    QNetworkRequest request(m_uploadUrl);
+    request.setHeader(QNetworkRequest::ContentTypeHeader,
+                     QString("multipart/form-data; boundary=%1").arg(multiPart->boundary().data()));
+    request.setRawHeader("key", key.toUtf8());
+
+    QNetworkReply* reply = m_networkManager->post(request, multiPart);
+    reply->setProperty("filePath", filePath);
+    multiPart->setParent(reply);
+    hashingBody->setParent(reply);
+    m_uploads.insert(reply, {jobId, key, hashingBody});
+
+    connect(reply, &QNetworkReply::uploadProgress, this, [this, jobId](qint64 bytesSent, qint64 bytesTotal) {
+        emit uploadProgress(jobId, bytesSent, bytesTotal);
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        handleUploadFinished(reply);
+    });
+}
+
+void UploadEngine::postFanOut(const QString& key, quint64 jobId, const QString& filePath,
+                              const QString& fileName, const QString& mimeType, QIODevice* body)
+{
+    // One read and one hash of the body, shared by every destination
+    auto* hashingBody = new HashingDevice(body, QCryptographicHash::Sha256);
+    auto buffer = std::make_shared<FanOutBuffer>(hashingBody, m_bufferPool);
+
+    // QHttpMultiPart cannot wait on a device that has no data yet, so the
+    // form framing is written around the shared stream by hand
+    const QByteArray boundary = "ezgui" + QByteArray::number(QRandomGenerator::global()->generate64(), 16);
+    const QByteArray prefix = "--" + boundary + "\r\n"
+                              "Content-Type: " + mimeType.toUtf8() + "\r\n"
+                              "Content-Disposition: form-data; name=\"file\"; filename=\"" + fileName.toUtf8() + "\"\r\n"
+                              "\r\n";
+    const QByteArray suffix = "\r\n--" + boundary + "--\r\n";
+
+    FanOutJob& job = m_fanOuts[jobId];
+    job.filePath = filePath;
+    job.buffer = buffer;
+
+    // Create every reader before any request starts reading
+    FanOutReader* primaryBody = buffer->createReader(prefix, suffix);
+    QList<FanOutReader*> mirrorBodies;
+    for (qsizetype i = 0; i < m_mirrors.size(); ++i) {
+        mirrorBodies.append(buffer->createReader());
+    }
+
+    QNetworkRequest request(m_uploadUrl);
+    request.setHeader(QNetworkRequest::ContentTypeHeader,
+                      QString("multipart/form-data; boundary=%1").arg(QString::fromLatin1(boundary)));
+    request.setHeader(QNetworkRequest::ContentLengthHeader, primaryBody->size());
+    // Otherwise QNAM copies a sequential body into memory before sending it
+    request.setAttribute(QNetworkRequest::DoNotBufferUploadDataAttribute, true);
+    request.setRawHeader("key", key.toUtf8());
+
+    QNetworkReply* reply = m_networkManager->post(request, primaryBody);
+    reply->setProperty("filePath", filePath);
+    primaryBody->setParent(reply);
+    m_uploads.insert(reply, {jobId, key, hashingBody});
+
+    connect(reply, &QNetworkReply::uploadProgress, this, [this, jobId](qint64 bytesSent, qint64 bytesTotal) {
+        emit uploadProgress(jobId, bytesSent, bytesTotal);
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        handleUploadFinished(reply);
+    });
+
+    // Same-named uploads (archives, .enc files) must not overwrite each other
+    const QString objectKey = MirrorDestination::uniqueObjectKey(fileName);
+    for (qsizetype i = 0; i < m_mirrors.size(); ++i) {
+        const MirrorDestination& mirror = m_mirrors[i];
+        FanOutReader* mirrorBody = mirrorBodies[i];
+
+        QNetworkRequest mirrorRequest = mirror.putRequest(objectKey, mimeType, buffer->sourceSize());
+        // A stalled mirror would hold the ring and the E-Z result forever
+        mirrorRequest.setTransferTimeout(MirrorTransferTimeoutMs);
+        QNetworkReply* mirrorReply = m_networkManager->put(mirrorRequest, mirrorBody);
+        mirrorBody->setParent(mirrorReply);
+        m_mirrorUploads.insert(mirrorReply, {jobId, mirror.name(), objectKey, mirror.objectUrl(objectKey)});
+        job.mirrorReplies.append(mirrorReply);
+
+        connect(mirrorReply, &QNetworkReply::finished, this, [this, mirrorReply]() {
+            handleMirrorFinished(mirrorReply);
+        });
+    }
+}
+
+void UploadEngine::handleMirrorFinished(QNetworkReply* reply)
+{
+    reply->deleteLater();
+    const MirrorUpload upload = m_mirrorUploads.take(reply);
+
+    // Gone if the E-Z upload already failed and took the job with it
+    auto it = m_fanOuts.find(upload.jobId);
+    if (it == m_fanOuts.end()) return;
+    FanOutJob& job = it->second;
+    job.mirrorReplies.removeOne(reply);
+
+    QJsonObject result;
+    if (reply->error() == QNetworkReply::NoError) {
+        result["url"] = upload.url.toString();
+        result["key"] = upload.objectKey;
+    } else if (reply->error() == QNetworkReply::OperationCanceledError) {
+        // Aborts by abortMirrors() never get here, so this is the timeout
+        result["error"] = QString("No progress for %1 seconds").arg(MirrorTransferTimeoutMs / 1000);
+    } else {
+        result["error"] = reply->errorString();
+    }
+    job.mirrors[upload.name] = result;
+
+    finishFanOut(upload.jobId);
+}
+
+void UploadEngine::finishFanOut(quint64 jobId)
+{
+    auto it = m_fanOuts.find(jobId);
+    if (it == m_fanOuts.end()) return;
+    const FanOutJob& job = it->second;
+    if (!job.primaryDone || !job.mirrorReplies.isEmpty()) return;
+
+    emit uploadSucceeded(jobId, job.filePath, job.imageUrl, job.rawUrl, job.deleteUrl,
+                         job.sha256, job.mirrors);
+    m_fanOuts.erase(it);
+}
+
+void UploadEngine::abortMirrors(quint64 jobId)
+{
+    auto it = m_fanOuts.find(jobId);
+    if (it == m_fanOuts.end()) return;
+
+    // The job is retried as a whole, mirrors included
+    const QList<QNetworkReply*> replies = it->second.mirrorReplies;
+    m_fanOuts.erase(it);
+    for (QNetworkReply* reply : replies) {
+        reply->abort();
+    }
+}
+
+void UploadEngine::handleUploadFinished(QNetworkReply* reply)
+{
+    reply->deleteLater();
+    const ActiveUpload upload = m_uploads.take(reply);
+    const quint64 jobId = upload.jobId;
+    const QString filePath = reply->property("filePath").toString();
+
+    // Return the key first so a waiting upload can take its slot; a 429
+    // benches it for Retry-After seconds, a 401/403 drops it for good
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const int retryAfter = reply->rawHeader("Retry-After").toInt();
+    const bool keyKept = m_keys.release(upload.key, statusCode, retryAfter);
+    if (!keyKept) {
+        emit apiKeyRejected(upload.key, m_keys.usableKeyCount());
+    }
+    startWaitingUploads();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        QString errorMsg = reply->errorString();
+        if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
+            errorMsg = QString("Server returned error %1: %2").arg(statusCode).arg(errorMsg);
+        }
+        // Another key, or the one the user enters next, may accept it
+        const bool retryable = isRetryable(reply) || !keyKept;
+        abortMirrors(jobId);
+        emit uploadFailed(jobId, filePath, errorMsg, retryable);
+        return;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
+    if (!doc.isObject()) {
+        abortMirrors(jobId);
+        emit uploadFailed(jobId, filePath, "Invalid response from server", false);
+        return;
+    }
+
+    QJsonObject obj = doc.object();
+    if (!obj["success"].toBool()) {
+        abortMirrors(jobId);
+        emit uploadFailed(jobId, filePath, obj["message"].toString("Unknown error"), false);
+        return;
+    }
+
+    QJsonObject data = obj["data"].toObject();
+    const QByteArray sha256 = upload.body ? upload.body->digest().toHex() : QByteArray();
+
+    auto fanOut = m_fanOuts.find(jobId);
+    if (fanOut == m_fanOuts.end()) {
+        emit uploadSucceeded(jobId, filePath, data["url"].toString(), data["raw"].toString(),
+                             data["delete"].toString(), sha256, QJsonObject());
+        return;
+    }
+
+    // Reported once the mirrors are done as well
+    FanOutJob& job = fanOut->second;
+    job.primaryDone = true;
+    job.imageUrl = data["url"].toString();
+    job.rawUrl = data["raw"].toString();
+    job.deleteUrl = data["delete"].toString();
+    job.sha256 = sha256;
+    finishFanOut(jobId);
+}
+
+void UploadEngine::fetchPreview(const QUrl& url, const QSize& targetSize, const QByteArray& key)
+{
+    // The panel shows one preview; a superseded one only holds pool blocks
+    std::vector<QNetworkReply*> previous;
+    for (const auto& entry : m_previews) {
+        previous.push_back(entry.first);
+    }
+    for (QNetworkReply* reply : previous) {
+        reply->abort();
+    }
+
+    QNetworkRequest request(url);
+    QNetworkReply* reply = m_networkManager->get(request);
+
+    // Keep QNAM's own buffer to one block; the rest lives in pool blocks
+    reply->setReadBufferSize(BufferPool::BlockSize);
+    reply->setProperty("previewUrl", url);
+    PendingPreview& preview = m_previews[reply];
+    preview.targetSize = targetSize;
+    preview.key = key;
+
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+        drainPreview(reply);
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        finishPreview(reply);
+    });
+}
+
+void UploadEngine::drainPreview(QNetworkReply* reply)
+{
+    auto it = m_previews.find(reply);
+    if (it == m_previews.end()) return;
+    PendingPreview& preview = it->second;
+
+    while (reply->bytesAvailable() > 0) {
+        if (preview.blocks.empty() || preview.blocks.back().size == BufferPool::BlockSize) {
+            // Blocks are held until the image is complete, so a preview must
+            // not be able to pin the budget the uploads run on
+            const qint64 held = qint64(preview.blocks.size()) * BufferPool::BlockSize;
+            if (held >= m_bufferPool->budget() / PreviewBudgetShare) {
+                reply->abort();
+                return;
+            }
+
+            BufferPool::Block block = m_bufferPool->tryAcquire();
+            if (block.isNull()) {
+                // Budget exhausted; retried by m_poolTimer unless it stays stuck
+                if (!preview.stalled.isValid()) {
+                    preview.stalled.start();
+                } else if (preview.stalled.hasExpired(PreviewStallTimeoutMs)) {
+                    reply->abort();
+                }
+                return;
+            }
+            preview.stalled.invalidate();
+            preview.blocks.push_back(std::move(block));
+        }
+
+        BufferPool::Block& block = preview.blocks.back();
+        qint64 n = reply->read(block.data() + block.size, BufferPool::BlockSize - block.size);
+        if (n <= 0) return;
+        block.size += n;
+        preview.received += n;
+    }
+}
+
+void UploadEngine::finishPreview(QNetworkReply* reply)
+{
+    reply->deleteLater();
+    const QUrl url = reply->property("previewUrl").toUrl();
+
+    // Move what is left in QNAM's buffer into pool blocks while they last
+    if (reply->error() == QNetworkReply::NoError) {
+        drainPreview(reply);
+    }
+
+    auto it = m_previews.find(reply);
+    if (it == m_previews.end()) return;
+    PendingPreview preview = std::move(it->second);
+    m_previews.erase(it);
+
+    if (reply->error() != QNetworkReply::NoError) {
+        emit previewFailed(url);
+        return;
+    }
+
+    // Decrypted and decoded where the bytes lie, so the only memory outside
+    // the pool is QNAM's own single-block buffer
+    Segments segments;
+    for (BufferPool::Block& block : preview.blocks) {
+        segments.parts.emplace_back(block.data(), block.size);
+    }
+    QByteArray tail = reply->readAll();
+    if (!tail.isEmpty()) {
+        segments.parts.emplace_back(tail.data(), tail.size());
+    }
+    qint64 size = preview.received + tail.size();
+
+    // Authenticated chunk by chunk; each plaintext chunk lands behind the
+    // ciphertext already read, so nothing unread is overwritten
+    if (!preview.key.isEmpty()) {
+        qint64 readOffset = 0;
+        qint64 writeOffset = 0;
+        size = EncryptingDevice::decrypt(size, [&](char* data, qint64 n) {
+            const bool ok = segments.read(readOffset, data, n);
+            readOffset += n;
+            return ok;
+        }, [&](const char* data, qint64 n) {
+            segments.write(writeOffset, data, n);
+            writeOffset += n;
+        }, preview.key);
+        if (size < 0) {
+            emit previewFailed(url);
+            return;
+        }
+    }
+
+    // Decode straight to the display size where the format allows it, so
+    // the GUI thread only has to blit the result
+    SegmentDevice device(segments, size);
+    QImageReader reader(&device);
+    const QSize fullSize = reader.size();
+    if (fullSize.isValid()) {
+        reader.setScaledSize(fullSize.scaled(preview.targetSize, Qt::KeepAspectRatio));
+    }
+    QImage image = reader.read();
+    if (image.isNull()) {
+        emit previewFailed(url);
+        return;
+    }
+    if (!fullSize.isValid()) {
+        image = image.scaled(preview.targetSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    emit previewReady(url, image);
+}
+
+void UploadEngine::setVerifyRateLimit(qint64 bytesPerSecond)
+{
+    m_verifyRate = qMax<qint64>(bytesPerSecond, VerifyReadBufferSize);
+}
+
+void UploadEngine::verifyUpload(const QString& rawUrl, const QByteArray& expectedSha256)
+{
+    if (rawUrl.isEmpty() || expectedSha256.isEmpty()) {
+        emit verificationFinished(rawUrl, "error", "No digest was recorded for this upload");
+        return;
+    }
+
+    m_pendingVerifications.append(qMakePair(rawUrl, expectedSha256));
+    startPendingVerifications();
+}
+
+void UploadEngine::startPendingVerifications()
+{
+    while (int(m_verifications.size()) < MaxConcurrentVerifications && !m_pendingVerifications.isEmpty()) {
+        const auto [rawUrl, expected] = m_pendingVerifications.takeFirst();
+
+        QNetworkRequest request{QUrl(rawUrl)};
+        QNetworkReply* reply = m_networkManager->get(request);
+
+        // Unread data stays in this small buffer, which throttles the socket
+        reply->setReadBufferSize(VerifyReadBufferSize);
+
+        ActiveVerification& verification = m_verifications[reply];
+        verification.rawUrl = rawUrl;
+        verification.expected = expected;
+        verification.hash = std::make_unique<QCryptographicHash>(QCryptographicHash::Sha256);
+
+        connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+            drainVerification(reply);
+        });
+        connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+            finishVerification(reply);
+        });
+    }
+
+    if (!m_verifications.empty() && !m_verifyTimer->isActive()) {
+        m_verifyTimer->start();
+    }
+}
+
+void UploadEngine::drainVerification(QNetworkReply* reply)
+{
+    auto it = m_verifications.find(reply);
+    if (it == m_verifications.end()) return;
+
+    QByteArray chunk;
+    while (m_verifyTokens > 0 && reply->bytesAvailable() > 0) {
+        chunk = reply->read(qMin(m_verifyTokens, VerifyReadBufferSize));
+        if (chunk.isEmpty()) return;
+        it->second.hash->addData(chunk);
+        m_verifyTokens -= chunk.size();
+    }
+}
+
+void UploadEngine::finishVerification(QNetworkReply* reply)
+{
+    reply->deleteLater();
+
+    auto it = m_verifications.find(reply);
+    if (it == m_verifications.end()) return;
+    ActiveVerification verification = std::move(it->second);
+    m_verifications.erase(it);
+
+    if (reply->error() != QNetworkReply::NoError) {
+        emit verificationFinished(verification.rawUrl, "error",
+                                  "Failed to download for verification: " + reply->errorString());
+    } else {
+        // At most one read buffer is left once the transfer completes
+        verification.hash->addData(reply->readAll());
+        const QByteArray actual = verification.hash->result().toHex();
+        if (actual == verification.expected) {
+            emit verificationFinished(verification.rawUrl, "ok", QString());
+        } else {
+            emit verificationFinished(verification.rawUrl, "mismatch",
+                                      QString("Checksum mismatch: expected %1, server returned %2")
+                                      .arg(QString::fromLatin1(verification.expected), QString::fromLatin1(actual)));
+        }
+    }
+
+    if (m_verifications.empty()) {
+        m_verifyTimer->stop();
+    }
+    startPendingVerifications();
+}
+
+void UploadEngine::deleteUploads(const QStringList& deleteUrls)
+{
+    for (const QString& deleteUrl : deleteUrls) {
+        if (!m_pendingDeleteUrls.contains(deleteUrl)) {
+            m_pendingDeleteUrls.insert(deleteUrl);
+            m_pendingDeletes.append(deleteUrl);
+        }
+    }
+    startPendingDeletes();
+}
+
+void UploadEngine::startPendingDeletes()
+{
+    while (m_activeDeletes < MaxConcurrentDeletes && !m_pendingDeletes.isEmpty()) {
+        const QString deleteUrl = m_pendingDeletes.takeFirst();
+        m_pendingDeleteUrls.remove(deleteUrl);
+
+        // The delete link is the same one the browser used to open; the key
+        // header lets the server attribute the request to the account
+        QNetworkRequest request{QUrl(deleteUrl)};
+        const QString key = m_keys.primaryKey();
+        if (!key.isEmpty()) {
+            request.setRawHeader("key", key.toUtf8());
+        }
+
+        QNetworkReply* reply = m_networkManager->get(request);
+        ++m_activeDeletes;
+
+        connect(reply, &QNetworkReply::finished, this, [this, reply, deleteUrl]() {
+            reply->deleteLater();
+            --m_activeDeletes;
+
+            int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (reply->error() == QNetworkReply::NoError) {
+                emit deleteFinished(deleteUrl, true, QString());
+            } else if (statusCode == 404) {
+                // Already gone on the server; nothing left to purge
+                emit deleteFinished(deleteUrl, true, QString());
+            } else {
+                emit deleteFinished(deleteUrl, false, reply->errorString());
+            }
+
+            startPendingDeletes();
+        });
+    }
+}
+
+bool UploadEngine::isRetryable(QNetworkReply* reply)
+{
+    const QVariant status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    if (!status.isValid()) {
+        // No HTTP response at all: offline, DNS, timeouts, dropped connection
+        return reply->error() != QNetworkReply::OperationCanceledError;
+    }
+
+    const int statusCode = status.toInt();
+    return statusCode == 408 || statusCode == 429 || statusCode >= 500;
+}
+
+QString UploadEngine::mimeTypeFor(const QString& filePath)
+{
+    QString extension = QFileInfo(filePath).suffix().toLower();
+
+    // Image types
+    if (extension == "jpg" || extension == "jpeg") return "image/jpeg";
+    if (extension == "png") return "image/png";
+    if (extension == "gif") return "image/gif";
+    if (extension == "webp") return "image/webp";
+    if (extension == "bmp") return "image/bmp";
+
+    // Video types
+    if (extension == "mp4") return "video/mp4";
+    if (extension == "webm") return "video/webm";
+    if (extension == "avi") return "video/x-msvideo";
+
+    // Audio types
+    if (extension == "mp3") return "audio/mpeg";
+    if (extension == "wav") return "audio/wav";
+    if (extension == "ogg") return "audio/ogg";
+
+    // Document types
+    if (extension == "pdf") return "application/pdf";
+    if (extension == "txt") return "text/plain";
+
+    // Default
+    return "application/octet-stream";
+}
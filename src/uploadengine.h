@@ -0,0 +1,197 @@
+#pragma once
+
+#include "apikeypool.h"
+#include "bufferpool.h"
+#include "mirrordestination.h"
+#include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QJsonObject>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <memory>
+#include <map>
+#include <vector>
+
+class QIODevice;
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+class FanOutBuffer;
+class HashingDevice;
+
+// Performs all network I/O for the uploader. An instance is moved onto a
+// dedicated QThread by MainWindow; every slot is invoked through a queued
+// connection and results are reported back through signals, so socket
+// reads, TLS and JSON parsing never run on the GUI thread.
+class UploadEngine : public QObject {
+    Q_OBJECT
+
+public:
+    explicit UploadEngine(QObject *parent = nullptr);
+    ~UploadEngine() override;
+
+public slots:
+    void setApiKeys(const QStringList& keys);
+    void setKeyRateLimit(int uploadsPerMinute);
+    void setMirrors(const QStringList& specs);
+    void validateApiKey(const QString& key);
+    // A non-empty key encrypts the upload client-side with that cipher
+    void upload(quint64 jobId, const QString& filePath, const QString& cipher, const QByteArray& key);
+    void uploadArchive(quint64 jobId, const QString& archiveName, const QStringList& sourcePaths,
+                       const QString& cipher, const QByteArray& key);
+    // A non-empty key decrypts the download before decoding it
+    void fetchPreview(const QUrl& url, const QSize& targetSize, const QByteArray& key);
+    void deleteUploads(const QStringList& deleteUrls);
+    void setMemoryBudget(qint64 bytes);
+    void verifyUpload(const QString& rawUrl, const QByteArray& expectedSha256);
+    void setVerifyRateLimit(qint64 bytesPerSecond);
+
+signals:
+    void apiKeyValidated(const QString& key, bool isValid, const QString& message);
+    // The server could not be reached (or failed with 5xx); key is neither valid nor invalid
+    void apiKeyUnverified(const QString& key, const QString& message);
+    // The server refused key (401/403); it is no longer used for uploads
+    void apiKeyRejected(const QString& key, int remainingKeys);
+    void archiveReady(quint64 jobId, const QStringList& memberNames, qint64 uncompressedSize);
+    void uploadProgress(quint64 jobId, qint64 bytesSent, qint64 bytesTotal);
+    // mirrors maps each mirror's name to {"url", "key"} or {"error"}
+    void uploadSucceeded(quint64 jobId, const QString& filePath, const QString& imageUrl,
+                         const QString& rawUrl, const QString& deleteUrl, const QByteArray& sha256,
+                         const QJsonObject& mirrors);
+    // retryable failures (connectivity, 5xx, rate limiting) may succeed later
+    void uploadFailed(quint64 jobId, const QString& filePath, const QString& message, bool retryable);
+    void previewReady(const QUrl& url, const QImage& image);
+    void previewFailed(const QUrl& url);
+    void deleteFinished(const QString& deleteUrl, bool success, const QString& message);
+    // status is "ok", "mismatch" (bytes differ) or "error" (could not check)
+    void verificationFinished(const QString& rawUrl, const QString& status, const QString& message);
+    void memoryUsageChanged(qint64 bytesInUse, qint64 peakBytes, qint64 budgetBytes);
+
+private:
+    void sendUpload(quint64 jobId, const QString& filePath, const QString& fileName,
+                    const QString& mimeType, QIODevice* body);
+    void startWaitingUploads();
+    void sendEncrypted(quint64 jobId, const QString& filePath, const QString& fileName,
+                       const QString& mimeType, QIODevice* body, const QString& cipher, const QByteArray& key);
+    void postUpload(const QString& key, quint64 jobId, const QString& filePath,
+                    const QString& fileName, const QString& mimeType, QIODevice* body);
+    void postFanOut(const QString& key, quint64 jobId, const QString& filePath,
+                    const QString& fileName, const QString& mimeType, QIODevice* body);
+    void handleUploadFinished(QNetworkReply* reply);
+    void handleMirrorFinished(QNetworkReply* reply);
+    void finishFanOut(quint64 jobId);
+    void abortMirrors(quint64 jobId);
+    void startPendingDeletes();
+    void drainPreview(QNetworkReply* reply);
+    void finishPreview(QNetworkReply* reply);
+    void reportMemoryUsage();
+    void startPendingVerifications();
+    void drainVerification(QNetworkReply* reply);
+    void finishVerification(QNetworkReply* reply);
+
+    static QString mimeTypeFor(const QString& filePath);
+    static bool isRetryable(QNetworkReply* reply);
+
+    static constexpr qint64 MaxUploadSize = 100 * 1024 * 1024;
+    static constexpr qint64 DefaultMemoryBudget = 64 * 1024 * 1024;
+    static constexpr int MirrorTransferTimeoutMs = 60 * 1000;
+
+    QNetworkAccessManager* m_networkManager = nullptr;
+    struct ActiveUpload {
+        quint64 jobId = 0;
+        QString key;
+        HashingDevice* body = nullptr;
+    };
+    QHash<QNetworkReply*, ActiveUpload> m_uploads;
+
+    // Uploads are spread over every configured key. Bodies that are ready
+    // while all keys are rate limited wait here until m_keyTimer fires.
+    ApiKeyPool m_keys;
+    struct WaitingUpload {
+        quint64 jobId = 0;
+        QString filePath;
+        QString fileName;
+        QString mimeType;
+        QIODevice* body = nullptr;
+    };
+    QList<WaitingUpload> m_waitingUploads;
+    QTimer* m_keyTimer = nullptr;
+
+    // With mirrors configured, each upload body is read once into a
+    // FanOutBuffer and streamed to E-Z and every mirror at the same time.
+    // The E-Z result is held back until all mirrors have finished.
+    QList<MirrorDestination> m_mirrors;
+    struct FanOutJob {
+        QString filePath;
+        std::shared_ptr<FanOutBuffer> buffer;
+        QList<QNetworkReply*> mirrorReplies;
+        bool primaryDone = false;
+        QString imageUrl;
+        QString rawUrl;
+        QString deleteUrl;
+        QByteArray sha256;
+        QJsonObject mirrors;
+    };
+    std::map<quint64, FanOutJob> m_fanOuts;
+    struct MirrorUpload {
+        quint64 jobId = 0;
+        QString name;
+        QString objectKey;
+        QUrl url;
+    };
+    QHash<QNetworkReply*, MirrorUpload> m_mirrorUploads;
+
+    // Every buffering stage draws from this pool; previews that cannot get a
+    // block stop reading (TCP backpressure) and are resumed by m_poolTimer.
+    // A preview holds its blocks until it completes, so it may take at most
+    // PreviewBudgetShare of the budget and is given up if it stalls for
+    // PreviewStallTimeoutMs; only one runs at a time.
+    std::shared_ptr<BufferPool> m_bufferPool;
+    struct PendingPreview {
+        QSize targetSize;
+        QByteArray key;
+        qint64 received = 0;
+        std::vector<BufferPool::Block> blocks;
+        QElapsedTimer stalled;
+    };
+    static constexpr int PreviewBudgetShare = 4;  // 1/4 of the budget
+    static constexpr int PreviewStallTimeoutMs = 5000;
+    std::map<QNetworkReply*, PendingPreview> m_previews;
+    QTimer* m_poolTimer = nullptr;
+    qint64 m_reportedUsage = -1;
+
+    QUrl m_uploadUrl;
+    QUrl m_validateUrl;
+
+    // Post-upload verification re-downloads the raw file and hashes it as
+    // it streams in. A shared token bucket caps its bandwidth; when it is
+    // empty replies are left unread and m_verifyTimer refills and resumes.
+    static constexpr int MaxConcurrentVerifications = 2;
+    static constexpr qint64 VerifyReadBufferSize = 64 * 1024;
+    struct ActiveVerification {
+        QString rawUrl;
+        QByteArray expected;
+        std::unique_ptr<QCryptographicHash> hash;
+    };
+    QList<QPair<QString, QByteArray>> m_pendingVerifications;
+    std::map<QNetworkReply*, ActiveVerification> m_verifications;
+    QTimer* m_verifyTimer = nullptr;
+    qint64 m_verifyRate = 1024 * 1024;
+    qint64 m_verifyTokens = 0;
+
+    // Batch deletion is throttled so purging a large history does not
+    // open hundreds of connections at once
+    static constexpr int MaxConcurrentDeletes = 4;
+    QStringList m_pendingDeletes;
+    // Membership of m_pendingDeletes, so large purges dedupe in O(1)
+    QSet<QString> m_pendingDeleteUrls;
+    int m_activeDeletes = 0;
+};
@@ -0,0 +1,304 @@
+#include "uploadqueue.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkInformation>
+#include <QSaveFile>
+#include <algorithm>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+UploadQueue::UploadQueue(const QString& journalPath, QObject *parent)
+    : QObject(parent)
+    , m_journalPath(journalPath)
+    , m_journal(journalPath)
+{
+    m_retryTimer.setSingleShot(true);
+    connect(&m_retryTimer, &QTimer::timeout, this, &UploadQueue::schedule);
+    m_syncTimer.setSingleShot(true);
+    m_syncTimer.setInterval(0);
+    connect(&m_syncTimer, &QTimer::timeout, this, &UploadQueue::syncJournal);
+
+    // Without a reachability backend we cannot tell, so assume online and
+    // let failures fall back to the retry backoff
+    if (QNetworkInformation::loadBackendByFeatures(QNetworkInformation::Feature::Reachability)) {
+        QNetworkInformation* info = QNetworkInformation::instance();
+        auto isOnline = [](QNetworkInformation::Reachability reachability) {
+            return reachability == QNetworkInformation::Reachability::Online ||
+                   reachability == QNetworkInformation::Reachability::Unknown;
+        };
+        m_online = isOnline(info->reachability());
+        connect(info, &QNetworkInformation::reachabilityChanged, this,
+                [this, isOnline](QNetworkInformation::Reachability reachability) {
+            setOnline(isOnline(reachability));
+        });
+    }
+}
+
+UploadQueue::~UploadQueue()
+{
+    if (m_syncTimer.isActive()) {
+        syncJournal();
+    }
+}
+
+void UploadQueue::restore()
+{
+    QDir().mkpath(QFileInfo(m_journalPath).absolutePath());
+
+    QFile journal(m_journalPath);
+    if (journal.open(QIODevice::ReadOnly)) {
+        while (!journal.atEnd()) {
+            // A torn last line from a crash fails to parse and is skipped
+            QJsonObject record = QJsonDocument::fromJson(journal.readLine()).object();
+            const QString op = record["op"].toString();
+            const quint64 jobId = quint64(record["id"].toInteger());
+            if (jobId == 0) continue;
+            m_nextJobId = qMax(m_nextJobId, jobId + 1);
+
+            if (op == "queued") {
+                Job job;
+                job.id = jobId;
+                job.kind = record["kind"].toString();
+                job.name = record["name"].toString();
+                job.attempts = record["attempts"].toInt();
+                for (const QJsonValue& path : record["paths"].toArray()) {
+                    job.paths.append(path.toString());
+                }
+                m_jobs.append(job);
+            } else if (op == "failed") {
+                auto it = findJob(jobId);
+                if (it != m_jobs.end()) {
+                    it->attempts = record["attempts"].toInt();
+                }
+            } else if (op == "done" || op == "abandoned") {
+                auto it = findJob(jobId);
+                if (it != m_jobs.end()) {
+                    m_jobs.erase(it);
+                }
+            }
+            // "started" needs no replay: a job still open was interrupted
+            // and simply runs again
+        }
+        journal.close();
+    }
+
+    compact();
+    emit stateChanged(m_online, pendingCount());
+    schedule();
+}
+
+quint64 UploadQueue::enqueue(const QString& kind, const QStringList& paths, const QString& name)
+{
+    Job job;
+    job.id = m_nextJobId++;
+    job.kind = kind;
+    job.paths = paths;
+    job.name = name;
+
+    QJsonObject record;
+    record["op"] = "queued";
+    record["id"] = qint64(job.id);
+    record["kind"] = kind;
+    record["name"] = name;
+    record["paths"] = QJsonArray::fromStringList(paths);
+    appendRecord(record, true);
+
+    m_jobs.append(job);
+    compactIfNeeded();
+    emit stateChanged(m_online, pendingCount());
+    schedule();
+    return job.id;
+}
+
+void UploadQueue::markFinished(quint64 jobId)
+{
+    auto it = findJob(jobId);
+    if (it == m_jobs.end()) return;
+
+    QJsonObject record;
+    record["op"] = "done";
+    record["id"] = qint64(jobId);
+    appendRecord(record);
+
+    if (it->running) --m_running;
+    m_jobs.erase(it);
+    compactIfNeeded();
+
+    emit stateChanged(m_online, pendingCount());
+    schedule();
+}
+
+void UploadQueue::markFailed(quint64 jobId, const QString& message, bool retryable)
+{
+    auto it = findJob(jobId);
+    if (it == m_jobs.end()) return;
+
+    if (it->running) --m_running;
+    it->running = false;
+    ++it->attempts;
+
+    QJsonObject record;
+    record["id"] = qint64(jobId);
+    record["error"] = message;
+    record["attempts"] = it->attempts;
+
+    if (!retryable || it->attempts >= MaxAttempts) {
+        record["op"] = "abandoned";
+        appendRecord(record);
+        const QString name = it->name;
+        m_jobs.erase(it);
+        emit jobAbandoned(jobId, name, message);
+    } else {
+        // 5s, 10s, 20s ... capped at five minutes
+        record["op"] = "failed";
+        appendRecord(record);
+        const int delay = 5 * (1 << qMin(it->attempts - 1, 6));
+        it->notBefore = QDateTime::currentDateTimeUtc().addSecs(qMin(delay, 300));
+    }
+    compactIfNeeded();
+
+    emit stateChanged(m_online, pendingCount());
+    schedule();
+}
+
+void UploadQueue::setPaused(bool paused)
+{
+    // Jobs that failed while the queue waited for a key run again at once
+    if (m_paused && !paused) {
+        for (Job& job : m_jobs) {
+            job.notBefore = QDateTime();
+        }
+    }
+    m_paused = paused;
+    schedule();
+}
+
+void UploadQueue::setMaxConcurrentJobs(int count)
+{
+    m_maxConcurrentJobs = qMax(count, 1);
+    schedule();
+}
+
+void UploadQueue::setOnline(bool online)
+{
+    if (online == m_online) return;
+    m_online = online;
+
+    // Connectivity is back: do not make queued jobs sit out their backoff
+    if (online) {
+        for (Job& job : m_jobs) {
+            job.notBefore = QDateTime();
+        }
+    }
+
+    emit onlineChanged(m_online);
+    emit stateChanged(m_online, pendingCount());
+    schedule();
+}
+
+void UploadQueue::schedule()
+{
+    if (m_paused || !m_online) return;
+
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    QDateTime nextRetry;
+    for (Job& job : m_jobs) {
+        if (m_running >= m_maxConcurrentJobs) break;
+        if (job.running) continue;
+
+        if (job.notBefore.isValid() && job.notBefore > now) {
+            if (!nextRetry.isValid() || job.notBefore < nextRetry) {
+                nextRetry = job.notBefore;
+            }
+            continue;
+        }
+
+        QJsonObject record;
+        record["op"] = "started";
+        record["id"] = qint64(job.id);
+        appendRecord(record);
+
+        job.running = true;
+        ++m_running;
+        emit jobReady(job.id, job.kind, job.paths, job.name);
+    }
+    compactIfNeeded();
+
+    if (nextRetry.isValid()) {
+        m_retryTimer.start(int(qMax<qint64>(now.msecsTo(nextRetry), 0)));
+    }
+}
+
+void UploadQueue::appendRecord(const QJsonObject& record, bool sync)
+{
+    if (!m_journal.isOpen() && !m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return;
+    }
+
+    m_journal.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+    m_journal.flush();
+    ++m_recordsSinceCompaction;
+
+    // A queued job exists nowhere else, so it has to reach the disk; one
+    // sync covers every record appended before control returns to the loop
+    if (sync && !m_syncTimer.isActive()) {
+        m_syncTimer.start();
+    }
+}
+
+void UploadQueue::syncJournal()
+{
+    m_syncTimer.stop();
+    // Closed means compact() replaced it, and QSaveFile syncs on commit
+    if (!m_journal.isOpen()) return;
+#ifdef Q_OS_WIN
+    _commit(m_journal.handle());
+#else
+    ::fsync(m_journal.handle());
+#endif
+}
+
+void UploadQueue::compactIfNeeded()
+{
+    if (m_recordsSinceCompaction >= CompactAfterRecords) {
+        compact();
+    }
+}
+
+void UploadQueue::compact()
+{
+    // Rewrite the journal with one record per live job; QSaveFile swaps it
+    // in atomically so a crash mid-compaction keeps the old journal
+    m_journal.close();
+
+    QSaveFile file(m_journalPath);
+    if (!file.open(QIODevice::WriteOnly)) return;
+
+    for (const Job& job : std::as_const(m_jobs)) {
+        QJsonObject record;
+        record["op"] = "queued";
+        record["id"] = qint64(job.id);
+        record["kind"] = job.kind;
+        record["name"] = job.name;
+        record["paths"] = QJsonArray::fromStringList(job.paths);
+        record["attempts"] = job.attempts;
+        file.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+    }
+
+    if (file.commit()) {
+        m_recordsSinceCompaction = 0;
+    }
+}
+
+QList<UploadQueue::Job>::iterator UploadQueue::findJob(quint64 jobId)
+{
+    return std::find_if(m_jobs.begin(), m_jobs.end(), [jobId](const Job& job) {
+        return job.id == jobId;
+    });
+}
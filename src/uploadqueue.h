@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QObject>
+#include <QDateTime>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+class QJsonObject;
+
+// Durable queue of upload jobs. Every state change is appended to a
+// JSON-lines write-ahead journal before it takes effect, so queued,
+// in-flight and retryable failed jobs survive a crash or restart and are
+// replayed on the next launch. Jobs are only handed out (jobReady) while
+// the queue is unpaused and QNetworkInformation reports the internet as
+// reachable; retryable failures are retried with exponential backoff.
+//
+// Delivery is at-least-once: a job that was in flight when the application
+// died is uploaded again. "queued" records are fsynced, once per burst of
+// enqueues (from a zero timer) so dropping many files costs one sync; the
+// other records are only flushed to the OS, so a power loss can at worst
+// replay a finished upload.
+class UploadQueue : public QObject {
+    Q_OBJECT
+
+public:
+    explicit UploadQueue(const QString& journalPath, QObject *parent = nullptr);
+    ~UploadQueue() override;
+
+    // Replays the journal; call once before enqueueing new jobs
+    void restore();
+
+    quint64 enqueue(const QString& kind, const QStringList& paths, const QString& name);
+    void markFinished(quint64 jobId);
+    void markFailed(quint64 jobId, const QString& message, bool retryable);
+
+    void setPaused(bool paused);
+    void setMaxConcurrentJobs(int count);
+    bool isOnline() const { return m_online; }
+    int pendingCount() const { return int(m_jobs.size()) - m_running; }
+
+signals:
+    void jobReady(quint64 jobId, const QString& kind, const QStringList& paths, const QString& name);
+    void jobAbandoned(quint64 jobId, const QString& name, const QString& message);
+    void stateChanged(bool online, int pendingCount);
+    void onlineChanged(bool online);
+
+private:
+    struct Job {
+        quint64 id = 0;
+        QString kind;
+        QStringList paths;
+        QString name;
+        int attempts = 0;
+        bool running = false;
+        QDateTime notBefore;
+    };
+
+    void appendRecord(const QJsonObject& record, bool sync = false);
+    void syncJournal();
+    // Call after m_jobs reflects every appended record
+    void compactIfNeeded();
+    void compact();
+    void schedule();
+    void setOnline(bool online);
+    QList<Job>::iterator findJob(quint64 jobId);
+
+    static constexpr int DefaultMaxConcurrentJobs = 4;
+    static constexpr int MaxAttempts = 20;
+    static constexpr int CompactAfterRecords = 512;
+
+    QString m_journalPath;
+    QFile m_journal;
+    int m_recordsSinceCompaction = 0;
+
+    QList<Job> m_jobs;
+    quint64 m_nextJobId = 1;
+    int m_running = 0;
+    int m_maxConcurrentJobs = DefaultMaxConcurrentJobs;
+    bool m_paused = true;
+    bool m_online = true;
+    QTimer m_retryTimer;
+    QTimer m_syncTimer;
+};